@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGNMENT 32
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t used;
+    size_t capacity;
+    _Alignas(ARENA_ALIGNMENT) unsigned char data[];
+};
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaBlock *arena_block_new(size_t capacity) {
+    ArenaBlock *block = aligned_alloc(ARENA_ALIGNMENT, align_up(sizeof(ArenaBlock) + capacity));
+    if (block == NULL) {
+        fprintf(stderr, "ERROR: unable to allocate arena block of %zu bytes\n", capacity);
+        exit(1);
+    }
+    block->next = NULL;
+    block->used = 0;
+    block->capacity = capacity;
+    return block;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = align_up(size);
+
+    while (arena->current != NULL && arena->current->used + size > arena->current->capacity) {
+        if (arena->current->next == NULL) break;
+        arena->current = arena->current->next;
+    }
+    if (arena->current == NULL || arena->current->used + size > arena->current->capacity) {
+        // Blocks double in size so that huge inputs need few of them.
+        size_t capacity = ARENA_BLOCK_CAPACITY;
+        if (arena->current != NULL && arena->current->capacity * 2 > capacity) {
+            capacity = arena->current->capacity * 2;
+        }
+        if (size > capacity) capacity = size;
+
+        ArenaBlock *block = arena_block_new(capacity);
+        if (arena->current == NULL) {
+            arena->first = block;
+        } else {
+            arena->current->next = block;
+        }
+        arena->current = block;
+    }
+
+    void *ptr = arena->current->data + arena->current->used;
+    arena->current->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL) return arena_alloc(arena, new_size);
+
+    if (ptr == arena->last) {
+        ArenaBlock *block = arena->current;
+        size_t offset = (unsigned char *)ptr - block->data;
+        if (offset + align_up(new_size) <= block->capacity) {
+            block->used = offset + align_up(new_size);
+            return ptr;
+        }
+    }
+    if (new_size <= old_size) return ptr;
+
+    void *new_ptr = arena_alloc(arena, new_size);
+    memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+void arena_reset(Arena *arena) {
+    for (ArenaBlock *block = arena->first; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->first;
+    arena->last = NULL;
+}
+
+void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->first;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    *arena = (Arena) {0};
+}
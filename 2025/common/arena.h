@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_CAPACITY (1 << 20)
+#define ARENA_DA_INIT_CAPACITY 64
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator for everything a run needs. Memory is only given back all
+// at once, by arena_reset (keeps the blocks for reuse) or arena_free.
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *current;
+    void *last;
+} Arena;
+
+void *arena_alloc(Arena *arena, size_t size);
+// Resizes an allocation. The most recent allocation grows and shrinks in
+// place while its block has room, anything else is copied.
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+
+// Growable arrays are structs with `items`, `size` and `capacity` fields
+// whose storage lives in an arena.
+#define arena_da_reserve(arena, da, n)                                       \
+    do {                                                                     \
+        if ((n) > (da)->capacity) {                                          \
+            size_t new_capacity = (da)->capacity ? (da)->capacity : ARENA_DA_INIT_CAPACITY; \
+            while (new_capacity < (n)) new_capacity *= 2;                    \
+            (da)->items = arena_realloc((arena), (da)->items,                \
+                                        (da)->capacity * sizeof(*(da)->items), \
+                                        new_capacity * sizeof(*(da)->items)); \
+            (da)->capacity = new_capacity;                                   \
+        }                                                                    \
+    } while (0)
+
+#define arena_da_append(arena, da, item)                                     \
+    do {                                                                     \
+        arena_da_reserve((arena), (da), (da)->size + 1);                     \
+        (da)->items[(da)->size++] = (item);                                  \
+    } while (0)
+
+#endif // ARENA_H
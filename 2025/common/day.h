@@ -0,0 +1,52 @@
+#ifndef DAY_H
+#define DAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+typedef unsigned __int128 uint128_t;
+
+// Every solution.c exports one Day so that the runner can link all of them
+// into a single binary. Everything else in a solution is static.
+//
+// parse reads the input once into a structure that lives in the given arena.
+// Both parts only borrow that structure and must leave it unchanged, so it
+// can be solved any number of times. Whatever a part allocates goes into the
+// scratch arena, which the caller resets between calls.
+typedef void  *(*ParseFn)(Arena *arena, char *file_path);
+typedef size_t (*PartFn)(void *input, Arena *scratch);
+
+// Alternative implementations of both parts, for example a parallel one.
+// They must give exactly the same answers as the default parts.
+typedef struct {
+    const char *name;
+    PartFn part1;
+    PartFn part2;
+} Variant;
+
+typedef struct {
+    const char *name;
+    ParseFn parse;
+    PartFn  part1;
+    PartFn  part2;
+    const Variant *variants;
+    size_t  variants_count;
+    size_t  test1;
+    size_t  test2;
+} Day;
+
+// Parts answer in 64 bits. A wider total is an error rather than a silently
+// wrapped answer.
+static inline size_t answer_narrow(uint128_t total, const char *what) {
+    if (total > SIZE_MAX) {
+        fprintf(stderr, "ERROR: %s does not fit in 64 bits\n", what);
+        exit(1);
+    }
+    return (size_t)total;
+}
+
+#endif // DAY_H
@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input.h"
+
+Span input_map(char *file_path) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
+        exit(1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "ERROR: unable to stat file %s\n", file_path);
+        exit(1);
+    }
+
+    Span input = { .data = NULL, .size = (size_t)st.st_size };
+    if (input.size > 0) {
+        void *data = mmap(NULL, input.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "ERROR: unable to map file %s\n", file_path);
+            exit(1);
+        }
+        madvise(data, input.size, MADV_SEQUENTIAL);
+        input.data = data;
+    }
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    return input;
+}
+
+void input_unmap(Span input) {
+    if (input.size > 0) {
+        munmap((void *)input.data, input.size);
+    }
+}
+
+Lines lines_from_span(Span span) {
+    return (Lines) { .cursor = span.data, .end = span.data + span.size };
+}
+
+int lines_next(Lines *lines, Span *line) {
+    if (lines->cursor >= lines->end) return 0;
+
+    size_t remaining = lines->end - lines->cursor;
+    const char *newline = memchr(lines->cursor, '\n', remaining);
+    size_t size = newline ? (size_t)(newline - lines->cursor) : remaining;
+
+    *line = (Span) { .data = lines->cursor, .size = size };
+    lines->cursor += newline ? size + 1 : size;
+    return 1;
+}
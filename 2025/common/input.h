@@ -0,0 +1,26 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+
+// Read-only view of bytes. Spans never own their memory.
+typedef struct {
+    const char *data;
+    size_t size;
+} Span;
+
+// Maps the whole file read-only. Exits on failure, like the parsers do.
+Span input_map(char *file_path);
+void input_unmap(Span input);
+
+// Iterates over the lines of a span without copying. Returned lines do not
+// include the '\n', and a missing newline at the end of the input is fine.
+typedef struct {
+    const char *cursor;
+    const char *end;
+} Lines;
+
+Lines lines_from_span(Span span);
+int lines_next(Lines *lines, Span *line);
+
+#endif // INPUT_H
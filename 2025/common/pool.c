@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t job_ready;
+    pthread_cond_t job_done;
+    size_t threads;
+    int started;
+
+    size_t generation;
+    size_t busy_workers;
+    PoolTaskFn fn;
+    void *ctx;
+    size_t tasks_count;
+    atomic_size_t next_task;
+} pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .job_ready = PTHREAD_COND_INITIALIZER,
+    .job_done = PTHREAD_COND_INITIALIZER,
+};
+
+void pool_set_threads(size_t threads) {
+    if (pool.started) {
+        fprintf(stderr, "ERROR: thread count set after the pool started\n");
+        exit(1);
+    }
+    pool.threads = threads;
+}
+
+size_t pool_threads(void) {
+    if (pool.threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        pool.threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    return pool.threads;
+}
+
+static void pool_work(void) {
+    size_t task;
+    while ((task = atomic_fetch_add(&pool.next_task, 1)) < pool.tasks_count) {
+        pool.fn(pool.ctx, task);
+    }
+}
+
+static void *pool_worker(void *arg) {
+    (void)arg;
+    size_t seen = 0;
+    pthread_mutex_lock(&pool.mutex);
+    for (;;) {
+        while (pool.generation == seen) {
+            pthread_cond_wait(&pool.job_ready, &pool.mutex);
+        }
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.mutex);
+
+        pool_work();
+
+        pthread_mutex_lock(&pool.mutex);
+        if (--pool.busy_workers == 0) {
+            pthread_cond_signal(&pool.job_done);
+        }
+    }
+    return NULL;
+}
+
+static void pool_start(void) {
+    for (size_t i = 1; i < pool_threads(); ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_worker, NULL) != 0) {
+            fprintf(stderr, "ERROR: unable to start worker thread\n");
+            exit(1);
+        }
+        pthread_detach(thread);
+    }
+    pool.started = 1;
+}
+
+void pool_run(size_t tasks_count, PoolTaskFn fn, void *ctx) {
+    if (pool_threads() == 1 || tasks_count <= 1) {
+        for (size_t task = 0; task < tasks_count; ++task) {
+            fn(ctx, task);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool.mutex);
+    if (!pool.started) pool_start();
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.tasks_count = tasks_count;
+    atomic_store(&pool.next_task, 0);
+    pool.busy_workers = pool.threads - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.job_ready);
+    pthread_mutex_unlock(&pool.mutex);
+
+    pool_work();
+
+    pthread_mutex_lock(&pool.mutex);
+    while (pool.busy_workers != 0) {
+        pthread_cond_wait(&pool.job_done, &pool.mutex);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+typedef struct {
+    size_t count;
+    size_t tasks_count;
+    PoolSliceFn fn;
+    void *ctx;
+    unsigned __int128 *totals;
+} SliceJob;
+
+static void slice_task(void *ctx, size_t task) {
+    SliceJob *job = ctx;
+    size_t beg = job->count * task / job->tasks_count;
+    size_t end = job->count * (task + 1) / job->tasks_count;
+    job->totals[task] = job->fn(job->ctx, beg, end);
+}
+
+unsigned __int128 pool_sum_slices(size_t count, size_t tasks_per_thread, PoolSliceFn fn, void *ctx, Arena *scratch) {
+    SliceJob job = { .count = count, .fn = fn, .ctx = ctx };
+    job.tasks_count = pool_threads() * tasks_per_thread;
+    if (job.tasks_count > count) job.tasks_count = count;
+    if (job.tasks_count == 0) return 0;
+    job.totals = arena_alloc(scratch, job.tasks_count * sizeof(unsigned __int128));
+
+    pool_run(job.tasks_count, slice_task, &job);
+
+    unsigned __int128 total = 0;
+    for (size_t i = 0; i < job.tasks_count; ++i) {
+        if (__builtin_add_overflow(total, job.totals[i], &total)) {
+            fprintf(stderr, "ERROR: sum of slices does not fit in 128 bits\n");
+            exit(1);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,25 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+#include "arena.h"
+
+// Worker threads shared by every day. A job is split into tasks that the
+// workers and the calling thread take from a shared counter, so uneven
+// tasks balance out on their own. Jobs must not start other jobs.
+typedef void (*PoolTaskFn)(void *ctx, size_t task);
+
+// Must be called before the first job. 0 means one thread per CPU.
+void pool_set_threads(size_t threads);
+size_t pool_threads(void);
+void pool_run(size_t tasks_count, PoolTaskFn fn, void *ctx);
+
+// Splits items [0, count) into tasks_per_thread contiguous slices per thread
+// and adds up what fn returns for each slice [beg, end). Every slice gets its
+// own total and they are added up once all are done, so the sum does not
+// depend on the thread count. A sum past 128 bits is an error.
+typedef unsigned __int128 (*PoolSliceFn)(void *ctx, size_t beg, size_t end);
+unsigned __int128 pool_sum_slices(size_t count, size_t tasks_per_thread, PoolSliceFn fn, void *ctx, Arena *scratch);
+
+#endif // POOL_H
@@ -1,49 +1,135 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <unistd.h>
 
-#define TURNS_ARRAY_BUF_SIZE 8192
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
+#include "../common/pool.h"
+
+#define DIAL_SIZE 100
+#define DIAL_START 50
+#define DIAL_CHUNKS_PER_THREAD 4
+#define DIAL_BLOCK 1024
 
 typedef struct {
-    int items[TURNS_ARRAY_BUF_SIZE];
-    int size;
+    int32_t *items;
+    size_t size;
+    size_t capacity;
 } TurnArray;
 
-TurnArray turn_array_from_file(char *file_path) {
-    TurnArray arr = {0};
+// Decodes the digits of a turn with SWAR: the (1 to 8) digits are loaded
+// as one word, shifted so that missing leading digits read as zero, and
+// combined pairwise in three multiplications.
+static int32_t turn_amount_swar(const char *digits, size_t count) {
+    uint64_t word;
+    memcpy(&word, digits, sizeof(word));
+    word <<= 8 * (8 - count);
+    word = ((word & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+    word = ((word & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+    return (int32_t)(((word & 0x0000FFFF0000FFFF) * 42949672960001) >> 32);
+}
 
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR: unable to read file: %s\n", file_path);
-        exit(1);
+static int32_t turn_amount_scalar(const char *digits, size_t count) {
+    int32_t amount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        amount = amount * 10 + digits[i] - 48;
     }
-    char line[64];
-    
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        if (arr.size == TURNS_ARRAY_BUF_SIZE) {
-            fprintf(stderr, "ERROR: insufficient buffer size: %d\n", arr.size);
-            exit(1);
+    return amount;
+}
+
+// Appends the turn in [line, line_end). The caller has reserved room for it.
+// A CR of a CRLF line ending and trailing spaces are trimmed first, and a
+// turn without digits is a turn by 0.
+static void turn_array_push_line(TurnArray *arr, const char *line, const char *line_end, const char *input_end) {
+    size_t size = line_end - line;
+    if (size == 0) return;
+    while (size > 1 && (line[size - 1] == '\r' || line[size - 1] == ' ')) --size;
+
+    const char *digits = line + 1;
+    size_t count = size - 1;
+    int32_t amount = (count != 0 && count <= 8 && digits + 8 <= input_end)
+        ? turn_amount_swar(digits, count)
+        : turn_amount_scalar(digits, count);
+    int32_t negate = -(int32_t)(line[0] == 'L');
+    arr->items[arr->size++] = (amount ^ negate) - negate;
+}
+
+static TurnArray *turn_array_from_file(Arena *arena, char *file_path) {
+    TurnArray *arr = arena_alloc(arena, sizeof(TurnArray));
+    *arr = (TurnArray) {0};
+
+    Span input = input_map(file_path);
+    const char *data = input.data;
+    const char *end = input.data + input.size;
+
+    // The shortest turn is a bare "R\n", the unused tail is given back below.
+    size_t max_turns = input.size / 2 + 1;
+    arena_da_reserve(arena, arr, max_turns);
+
+    // Newlines are found a whole register at a time, then every line in the
+    // block is decoded before the next load.
+    const char *line = data;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; i + 32 <= input.size; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+        while (mask != 0) {
+            const char *line_end = data + i + __builtin_ctz(mask);
+            turn_array_push_line(arr, line, line_end, end);
+            line = line_end + 1;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= input.size; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        while (mask != 0) {
+            const char *line_end = data + i + __builtin_ctz(mask);
+            turn_array_push_line(arr, line, line_end, end);
+            line = line_end + 1;
+            mask &= mask - 1;
         }
-        int sign = (line[0] == 'L') ? -1 : 1;
-        arr.items[arr.size] = atoi(line + 1) * sign;
-        arr.size++;
     }
+#endif
+    for (; i < input.size; ++i) {
+        if (data[i] != '\n') continue;
+        turn_array_push_line(arr, line, data + i, end);
+        line = data + i + 1;
+    }
+    turn_array_push_line(arr, line, end, end);
+
+    arr->items = arena_realloc(arena, arr->items, max_turns * sizeof(int32_t), arr->size * sizeof(int32_t));
+    arr->capacity = arr->size;
+    input_unmap(input);
     return arr;
 }
 
-int modulo(int a, int b) {
+static int modulo(int a, int b) {
     return ((a % b) + b) % b;
 }
 
-int part1(char *file_path) {
-    TurnArray turn = turn_array_from_file(file_path);
+static size_t part1(void *input, Arena *scratch) {
+    (void)scratch;
+    TurnArray *turn = input;
     
-    int count = 0;
+    size_t count = 0;
     int dial_value = 50;
     const int dial_size = 100;
     
-    for (int i = 0; i < turn.size; ++i) {
-        dial_value = modulo(dial_value + turn.items[i], dial_size);
+    for (size_t i = 0; i < turn->size; ++i) {
+        dial_value = modulo(dial_value + turn->items[i], dial_size);
         if (dial_value == 0) {
             count++;
         }
@@ -51,20 +137,21 @@ int part1(char *file_path) {
     return count;
 }
 
-int part2(char *file_path) {
-    TurnArray turn = turn_array_from_file(file_path);
+static size_t part2(void *input, Arena *scratch) {
+    (void)scratch;
+    TurnArray *turn = input;
 
-    int count = 0;
+    size_t count = 0;
     int dial_value = 50;
     const int dial_size = 100;
     
-    for (int i = 0; i < turn.size; ++i) {
-        dial_value += turn.items[i];
+    for (size_t i = 0; i < turn->size; ++i) {
+        dial_value += turn->items[i];
 
         if (dial_value > 0) {
             count += dial_value / dial_size;
         } else {
-            if (dial_value != turn.items[i]) count += 1;
+            if (dial_value != turn->items[i]) count += 1;
             count -= dial_value / dial_size;
         }
         dial_value = modulo(dial_value, dial_size);
@@ -72,12 +159,263 @@ int part2(char *file_path) {
     return count;
 }
 
+static int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return q - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+// Smallest start position from which x + start reaches the next multiple of
+// the dial size, or DIAL_SIZE if it is already on one.
+static size_t dial_threshold(int64_t x) {
+    int64_t m = x - floor_div(x, DIAL_SIZE) * DIAL_SIZE;
+    return m == 0 ? DIAL_SIZE : DIAL_SIZE - m;
+}
+
+// What a run of turns does to the dial, for every position it can start at.
+// Chunks are summarised independently and then composed left to right: a
+// chunk's zeros are looked up at the position the chunks before it left.
+typedef struct {
+    int64_t offset;
+    size_t zeros[DIAL_SIZE];
+} DialChunk;
+
+typedef struct {
+    TurnArray *turn;
+    DialChunk *chunks;
+    size_t chunks_count;
+    int passes;
+} DialJob;
+
+static void dial_chunk_task(void *ctx, size_t task) {
+    DialJob *job = ctx;
+    int32_t *items = job->turn->items;
+    size_t begin = job->turn->size * task / job->chunks_count;
+    size_t end = job->turn->size * (task + 1) / job->chunks_count;
+
+    // Positions are relative to the chunk start and never wrapped. Shifting
+    // them all by the start position s only changes a floor division where
+    // s crosses dial_threshold, so every turn adds a constant to `base` and
+    // moves a couple of steps in `steps`.
+    int64_t steps[DIAL_SIZE + 1] = {0};
+    int64_t base = 0;
+    int64_t position = 0;
+    for (size_t i = begin; i < end; ++i) {
+        int64_t next = position + items[i];
+        if (!job->passes) {
+            // Lands on zero from s when s >= threshold(next) and below it
+            // for the previous multiple, i.e. exactly at the threshold.
+            size_t t = dial_threshold(next) % DIAL_SIZE;
+            steps[t]++;
+            steps[t + 1]--;
+        } else if (next > position) {
+            base += floor_div(next, DIAL_SIZE) - floor_div(position, DIAL_SIZE);
+            steps[dial_threshold(next)]++;
+            steps[dial_threshold(position)]--;
+        } else if (next < position) {
+            base += floor_div(position - 1, DIAL_SIZE) - floor_div(next - 1, DIAL_SIZE);
+            steps[dial_threshold(position - 1)]++;
+            steps[dial_threshold(next - 1)]--;
+        }
+        position = next;
+    }
+
+    DialChunk *chunk = &job->chunks[task];
+    chunk->offset = position;
+    int64_t zeros = base;
+    for (size_t s = 0; s < DIAL_SIZE; ++s) {
+        zeros += steps[s];
+        chunk->zeros[s] = (size_t)zeros;
+    }
+}
+
+static size_t dial_count_parallel(TurnArray *turn, Arena *scratch, int passes) {
+    size_t chunks_count = pool_threads() * DIAL_CHUNKS_PER_THREAD;
+    if (chunks_count > turn->size) chunks_count = turn->size;
+
+    DialJob job = {
+        .turn = turn,
+        .chunks = arena_alloc(scratch, chunks_count * sizeof(DialChunk)),
+        .chunks_count = chunks_count,
+        .passes = passes
+    };
+    pool_run(chunks_count, dial_chunk_task, &job);
+
+    size_t count = 0;
+    int64_t position = DIAL_START;
+    for (size_t i = 0; i < chunks_count; ++i) {
+        count += job.chunks[i].zeros[position];
+        position = (position + job.chunks[i].offset) - floor_div(position + job.chunks[i].offset, DIAL_SIZE) * DIAL_SIZE;
+    }
+    return count;
+}
+
+static size_t part1_parallel(void *input, Arena *scratch) {
+    return dial_count_parallel(input, scratch, 0);
+}
+
+static size_t part2_parallel(void *input, Arena *scratch) {
+    return dial_count_parallel(input, scratch, 1);
+}
+
+// floor(x / DIAL_SIZE) without a division. Negative x are mirrored with ~x,
+// so one unsigned multiply-shift (exact for all 32-bit values) does both.
+static int32_t dial_floor_div(int32_t x) {
+    int32_t sign = x >> 31;
+    uint32_t u = (uint32_t)(x ^ sign);
+    return (int32_t)(((uint64_t)u * 1374389535u) >> 37) ^ sign;
+}
+
+// Splits every turn of a block into whole laps and 0..99 remaining steps,
+// then walks the dial with those steps. Only the walk is serial, and it is
+// just an add and a conditional subtract per turn.
+static int32_t dial_walk_block(const int32_t *items, size_t n, int32_t position,
+                               int32_t *laps, int32_t *steps, int32_t *starts) {
+    for (size_t i = 0; i < n; ++i) {
+        laps[i] = dial_floor_div(items[i]);
+        steps[i] = items[i] - laps[i] * DIAL_SIZE;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        starts[i] = position;
+        position += steps[i];
+        position -= (position >= DIAL_SIZE) * DIAL_SIZE;
+    }
+    return position;
+}
+
+static size_t part1_branchless(void *input, Arena *scratch) {
+    (void)scratch;
+    TurnArray *turn = input;
+    int32_t laps[DIAL_BLOCK];
+    int32_t steps[DIAL_BLOCK];
+    int32_t starts[DIAL_BLOCK + 1];
+
+    size_t count = 0;
+    int32_t position = DIAL_START;
+    for (size_t begin = 0; begin < turn->size; begin += DIAL_BLOCK) {
+        size_t n = turn->size - begin < DIAL_BLOCK ? turn->size - begin : DIAL_BLOCK;
+        position = dial_walk_block(turn->items + begin, n, position, laps, steps, starts);
+        starts[n] = position;
+        for (size_t i = 1; i <= n; ++i) {
+            count += starts[i] == 0;
+        }
+    }
+    return count;
+}
+
+// A turn from p clicks past zero |F(p + t - L) - F(p - L)| times, where F is
+// floor division by the dial size and L is 1 for left turns. With t split
+// into laps and steps both F terms reduce to comparisons against 0 and 100.
+static size_t part2_branchless(void *input, Arena *scratch) {
+    (void)scratch;
+    TurnArray *turn = input;
+    int32_t laps[DIAL_BLOCK];
+    int32_t steps[DIAL_BLOCK];
+    int32_t starts[DIAL_BLOCK];
+
+    int64_t count = 0;
+    int32_t position = DIAL_START;
+    for (size_t begin = 0; begin < turn->size; begin += DIAL_BLOCK) {
+        const int32_t *items = turn->items + begin;
+        size_t n = turn->size - begin < DIAL_BLOCK ? turn->size - begin : DIAL_BLOCK;
+        position = dial_walk_block(items, n, position, laps, steps, starts);
+        for (size_t i = 0; i < n; ++i) {
+            int32_t left = items[i] < 0;
+            int32_t end = starts[i] + steps[i] - left;
+            int32_t start = starts[i] - left;
+            int32_t crossings = laps[i] + (end >= DIAL_SIZE) - (end < 0) + (start < 0);
+            int32_t sign = crossings >> 31;
+            count += (crossings ^ sign) - sign;
+        }
+    }
+    return (size_t)count;
+}
+
+static const Variant variants[] = {
+    { .name = "parallel", .part1 = part1_parallel, .part2 = part2_parallel },
+    { .name = "branchless", .part1 = part1_branchless, .part2 = part2_branchless },
+};
+
+static void *parse(Arena *arena, char *file_path) {
+    return turn_array_from_file(arena, file_path);
+}
+
+const Day day01 = {
+    .name = "day01",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .variants = variants,
+    .variants_count = sizeof(variants) / sizeof(variants[0]),
+    .test1 = 3,
+    .test2 = 6
+};
+
+#ifndef AOC_RUNNER
 int main() {
-    assert(part1("day01/test.txt") == 3);
-    assert(part2("day01/test.txt") == 6);
+    Arena arena = {0};
+
+    TurnArray *test = parse(&arena, "day01/test.txt");
+    assert(part1(test, &arena) == 3);
+    assert(part2(test, &arena) == 6);
+    assert(part1_parallel(test, &arena) == 3);
+    assert(part2_parallel(test, &arena) == 6);
+    assert(part1_branchless(test, &arena) == 3);
+    assert(part2_branchless(test, &arena) == 6);
+    arena_reset(&arena);
+
+    // Bare "R" lines are turns by 0, and more of them fit in a file than
+    // turns with digits do.
+    char bare_path[] = "/tmp/day01-XXXXXX";
+    int bare_fd = mkstemp(bare_path);
+    assert(bare_fd >= 0);
+    assert(write(bare_fd, "L50\n", 4) == 4);
+    for (size_t i = 0; i < 64; ++i) {
+        assert(write(bare_fd, "R\n", 2) == 2);
+    }
+    close(bare_fd);
+    TurnArray *bare = parse(&arena, bare_path);
+    unlink(bare_path);
+    assert(bare->size == 65);
+    assert(part1(bare, &arena) == 65);
+    assert(part2(bare, &arena) == 1);
+    assert(part1_parallel(bare, &arena) == 65);
+    assert(part2_parallel(bare, &arena) == 1);
+    assert(part1_branchless(bare, &arena) == 65);
+    assert(part2_branchless(bare, &arena) == 1);
+    arena_reset(&arena);
+
+    // A CRLF copy of test.txt, with trailing spaces on every other line,
+    // gives the same answers.
+    char crlf_path[] = "/tmp/day01-XXXXXX";
+    int crlf_fd = mkstemp(crlf_path);
+    assert(crlf_fd >= 0);
+    Span test_span = input_map("day01/test.txt");
+    size_t lines_count = 0;
+    for (size_t i = 0; i < test_span.size; ++i) {
+        if (test_span.data[i] == '\n') {
+            const char *ending = (lines_count++ % 2 == 0) ? "  \r\n" : "\r\n";
+            assert(write(crlf_fd, ending, strlen(ending)) == (ssize_t)strlen(ending));
+        } else {
+            assert(write(crlf_fd, test_span.data + i, 1) == 1);
+        }
+    }
+    input_unmap(test_span);
+    close(crlf_fd);
+    TurnArray *crlf = parse(&arena, crlf_path);
+    unlink(crlf_path);
+    assert(part1(crlf, &arena) == 3);
+    assert(part2(crlf, &arena) == 6);
+    assert(part1_parallel(crlf, &arena) == 3);
+    assert(part2_parallel(crlf, &arena) == 6);
+    assert(part1_branchless(crlf, &arena) == 3);
+    assert(part2_branchless(crlf, &arena) == 6);
+    arena_reset(&arena);
 
-    printf("Door password: %d\n", part1("day01/input.txt"));
-    printf("Method 0x434C49434B: %d\n", part2("day01/input.txt"));
+    TurnArray *input = parse(&arena, "day01/input.txt");
+    printf("Door password: %zu\n", part1(input, &arena));
+    printf("Method 0x434C49434B: %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
     return 0;
 }
+#endif // AOC_RUNNER
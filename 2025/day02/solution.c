@@ -1,36 +1,39 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
+#include "../common/pool.h"
+
 typedef struct {
     size_t start;
     size_t end;
 } IdRange;
 
 typedef struct {
-    IdRange items[64];
+    IdRange *items;
     size_t size;
+    size_t capacity;
 } IdRangeArray;
 
-IdRangeArray ira_from(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
-        exit(1);
-    }
-    IdRangeArray ira = {};
+static IdRangeArray *ira_from(Arena *arena, char *file_path) {
+    Span input = input_map(file_path);
+    IdRangeArray *ira = arena_alloc(arena, sizeof(IdRangeArray));
+    *ira = (IdRangeArray) {0};
 
     size_t a = 0;
     size_t b = 0;
-    char c;
-    while ((c = fgetc(fp)) != EOF) {
+    for (size_t i = 0; i < input.size; ++i) {
+        char c = input.data[i];
         if (c == '-') {
             a = b;
             b = 0;
         } else if (c == ',' || c == '\n') {
-            ira.items[ira.size] = (IdRange) { .start = a, .end = b };
-            ira.size++;
+            arena_da_append(arena, ira, ((IdRange) { .start = a, .end = b }));
             if (c == '\n') break;
             a = 0;
             b = 0;
@@ -38,11 +41,12 @@ IdRangeArray ira_from(char *file_path) {
             b = b * 10 + c - 48;
         }
     }
+    input_unmap(input);
     return ira;
 }
 
 
-size_t count_digits(size_t n) {
+static size_t count_digits(size_t n) {
     size_t count = 0;
     while (n > 0) {
         n /= 10;
@@ -51,7 +55,13 @@ size_t count_digits(size_t n) {
     return count;
 }
 
-size_t power_of_ten(size_t e) {
+// Zero has no repeated form, so the digit lengths start at 1.
+static size_t count_digits_min1(size_t n) {
+    size_t digits = count_digits(n);
+    return digits > 0 ? digits : 1;
+}
+
+static size_t power_of_ten(size_t e) {
     size_t result = 1;
     for (size_t i = 0; i < e; ++i) {
         result *= 10;
@@ -59,17 +69,69 @@ size_t power_of_ten(size_t e) {
     return result;
 }
 
-size_t part1(char *file_path) {
-    IdRangeArray ira = ira_from(file_path);
-    size_t invalid_id_sum = 0;
+#define ID_SET_INIT_CAPACITY 1024
+
+// Open-addressing set of IDs with linear probing, kept at most half full.
+// 0 marks an empty slot, which is fine because 0 is never an invalid ID.
+typedef struct {
+    size_t *slots;
+    size_t capacity;
+    size_t size;
+} IdSet;
+
+static size_t id_hash(size_t id) {
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccd;
+    id ^= id >> 33;
+    return id;
+}
+
+static void id_set_place(IdSet *set, size_t id) {
+    size_t mask = set->capacity - 1;
+    size_t slot = id_hash(id) & mask;
+    while (set->slots[slot] != 0) slot = (slot + 1) & mask;
+    set->slots[slot] = id;
+}
+
+static void id_set_grow(Arena *arena, IdSet *set) {
+    size_t capacity = set->capacity ? 2 * set->capacity : ID_SET_INIT_CAPACITY;
+    IdSet grown = {
+        .slots = arena_alloc(arena, capacity * sizeof(size_t)),
+        .capacity = capacity,
+        .size = set->size
+    };
+    memset(grown.slots, 0, grown.capacity * sizeof(size_t));
+    for (size_t i = 0; i < set->capacity; ++i) {
+        if (set->slots[i] != 0) id_set_place(&grown, set->slots[i]);
+    }
+    *set = grown;
+}
+
+// Returns 1 if the ID was not in the set yet.
+static int id_set_insert(Arena *arena, IdSet *set, size_t id) {
+    if (2 * (set->size + 1) > set->capacity) id_set_grow(arena, set);
 
-    size_t invalid_ids[1024];
-    size_t invalid_ids_size = 0;
+    size_t mask = set->capacity - 1;
+    size_t slot = id_hash(id) & mask;
+    while (set->slots[slot] != 0) {
+        if (set->slots[slot] == id) return 0;
+        slot = (slot + 1) & mask;
+    }
+    set->slots[slot] = id;
+    set->size++;
+    return 1;
+}
+
+static size_t part1_enumerate(void *input, Arena *scratch) {
+    IdRangeArray *ira = input;
+    uint128_t invalid_id_sum = 0;
 
-    for (size_t i = 0; i < ira.size; ++i) {
-        size_t start = ira.items[i].start;
-        size_t end = ira.items[i].end;
-        size_t start_digits = count_digits(start);
+    IdSet invalid_ids = {0};
+
+    for (size_t i = 0; i < ira->size; ++i) {
+        size_t start = ira->items[i].start;
+        size_t end = ira->items[i].end;
+        size_t start_digits = count_digits_min1(start);
         size_t end_digits = count_digits(end);
 
         for (size_t digits = start_digits; digits <= end_digits; ++digits) {
@@ -85,38 +147,28 @@ size_t part1(char *file_path) {
             for (size_t k = 0; k < 9 * multiplier / 10; ++k) {
                 if (candidate > end) break;
                 if (candidate >= start) {
-                    int found_duplicate = 0;
-                    for (size_t l = 0; l < invalid_ids_size; ++l) {
-                        if (invalid_ids[l] == candidate) {
-                            found_duplicate = 1;
-                            break;
-                        }
-                    }
-                    if (!found_duplicate) {
+                    if (id_set_insert(scratch, &invalid_ids, candidate)) {
                         invalid_id_sum += candidate;
-                        invalid_ids[invalid_ids_size] = candidate;
-                        invalid_ids_size++;
                     }
                 }
                 candidate += increment;
             }
         }
     }
-    return invalid_id_sum;
+    return answer_narrow(invalid_id_sum, "invalid ID sum");
 }
 
-size_t part2(char *file_path) {
-    IdRangeArray ira = ira_from(file_path);
-    size_t invalid_id_sum = 0;
+static size_t part2_enumerate(void *input, Arena *scratch) {
+    IdRangeArray *ira = input;
+    uint128_t invalid_id_sum = 0;
 
-    size_t invalid_ids[1024];
-    size_t invalid_ids_size = 0;
+    IdSet invalid_ids = {0};
 
-    for (size_t i = 0; i < ira.size; ++i) {
+    for (size_t i = 0; i < ira->size; ++i) {
 
-        size_t start = ira.items[i].start;
-        size_t end = ira.items[i].end;
-        size_t start_digits = count_digits(start);
+        size_t start = ira->items[i].start;
+        size_t end = ira->items[i].end;
+        size_t start_digits = count_digits_min1(start);
         size_t end_digits = count_digits(end);
 
         for (size_t digits = start_digits; digits <= end_digits; ++digits) {
@@ -132,17 +184,8 @@ size_t part2(char *file_path) {
                 for (size_t k = 0; k < 9 * multiplier / 10; ++k) {
                     if (candidate > end) break;
                     if (candidate >= start) {
-                        int found_duplicate = 0;
-                        for (size_t l = 0; l < invalid_ids_size; ++l) {
-                            if (invalid_ids[l] == candidate) {
-                                found_duplicate = 1;
-                                break;
-                            }
-                        }
-                        if (!found_duplicate) {
+                        if (id_set_insert(scratch, &invalid_ids, candidate)) {
                             invalid_id_sum += candidate;
-                            invalid_ids[invalid_ids_size] = candidate;
-                            invalid_ids_size++;
                         }
                     }
                     candidate += increment;
@@ -150,14 +193,199 @@ size_t part2(char *file_path) {
             }
         }
     }
-    return invalid_id_sum;
+    return answer_narrow(invalid_id_sum, "invalid ID sum");
+}
+
+static int compare_id_ranges(const void *a, const void *b) {
+    const IdRange *x = a;
+    const IdRange *y = b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+// Sorted copy of the ranges with overlapping ones merged, so that no ID is
+// in more than one range and every range can be summed on its own.
+static IdRangeArray ira_merged(IdRangeArray *ira, Arena *scratch) {
+    IdRangeArray merged = {0};
+    arena_da_reserve(scratch, &merged, ira->size);
+    memcpy(merged.items, ira->items, ira->size * sizeof(IdRange));
+    qsort(merged.items, ira->size, sizeof(IdRange), compare_id_ranges);
+
+    for (size_t i = 0; i < ira->size; ++i) {
+        IdRange range = merged.items[i];
+        if (merged.size > 0 && range.start <= merged.items[merged.size - 1].end) {
+            IdRange *last = &merged.items[merged.size - 1];
+            if (range.end > last->end) last->end = range.end;
+        } else {
+            merged.items[merged.size++] = range;
+        }
+    }
+    return merged;
 }
 
+
+static uint128_t power_of_ten_u128(size_t e) {
+    uint128_t result = 1;
+    for (size_t i = 0; i < e; ++i) {
+        result *= 10;
+    }
+    return result;
+}
+
+static int mobius(size_t n) {
+    int result = 1;
+    for (size_t p = 2; p * p <= n; ++p) {
+        if (n % p != 0) continue;
+        n /= p;
+        if (n % p == 0) return 0;
+        result = -result;
+    }
+    if (n > 1) result = -result;
+    return result;
+}
+
+// Sum of the numbers in [start, end] with exactly `digits` digits that are
+// one `seq_length` digit block repeated. Those are block * repunit, with
+// repunit = 10..010..01, so the valid blocks form one interval and their
+// sum is an arithmetic series.
+static uint128_t repeated_sum(size_t start, size_t end, size_t digits, size_t seq_length) {
+    uint128_t multiplier = power_of_ten_u128(seq_length);
+    uint128_t repunit = (power_of_ten_u128(digits) - 1) / (multiplier - 1);
+
+    uint128_t first = multiplier / 10;
+    uint128_t last = multiplier - 1;
+    uint128_t first_in_range = (start + repunit - 1) / repunit;
+    uint128_t last_in_range = end / repunit;
+    if (first_in_range > first) first = first_in_range;
+    if (last_in_range < last) last = last_in_range;
+    if (first > last) return 0;
+
+    return repunit * ((first + last) * (last - first + 1) / 2);
+}
+
+// Each range costs O(digits^2) regardless of its width.
+static uint128_t range_sum_halves(size_t start, size_t end) {
+    uint128_t sum = 0;
+    for (size_t digits = count_digits_min1(start); digits <= count_digits(end); ++digits) {
+        if (digits % 2 != 0) continue;
+        sum += repeated_sum(start, end, digits, digits / 2);
+    }
+    return sum;
+}
+
+// A number built from repeats of some shorter block has a primitive period
+// p < digits. Möbius inversion over the divisors of digits turns the sums
+// for every block length into the sum over that union:
+//   sum = -sum_{q | digits, q < digits} mu(digits / q) * S(q)
+static uint128_t range_sum_repeats(size_t start, size_t end) {
+    __int128 sum = 0;
+    for (size_t digits = count_digits_min1(start); digits <= count_digits(end); ++digits) {
+        for (size_t seq_length = 1; seq_length < digits; ++seq_length) {
+            if (digits % seq_length != 0) continue;
+            int mu = mobius(digits / seq_length);
+            if (mu == 0) continue;
+            sum -= mu * (__int128)repeated_sum(start, end, digits, seq_length);
+        }
+    }
+    return (uint128_t)sum;
+}
+
+typedef uint128_t (*RangeSumFn)(size_t start, size_t end);
+
+static size_t ranges_total(IdRangeArray *ira, RangeSumFn range_sum, Arena *scratch) {
+    IdRangeArray ranges = ira_merged(ira, scratch);
+    uint128_t total = 0;
+    for (size_t i = 0; i < ranges.size; ++i) {
+        total += range_sum(ranges.items[i].start, ranges.items[i].end);
+    }
+    return answer_narrow(total, "invalid ID sum");
+}
+
+static size_t part1(void *input, Arena *scratch) {
+    return ranges_total(input, range_sum_halves, scratch);
+}
+
+static size_t part2(void *input, Arena *scratch) {
+    return ranges_total(input, range_sum_repeats, scratch);
+}
+
+#define RANGE_TASKS_PER_THREAD 8
+
+// Merged ranges share no IDs, so slices of them can be summed independently.
+typedef struct {
+    IdRangeArray ranges;
+    RangeSumFn range_sum;
+} RangeJob;
+
+static uint128_t range_slice_sum(void *ctx, size_t beg, size_t end) {
+    RangeJob *job = ctx;
+    uint128_t total = 0;
+    for (size_t i = beg; i < end; ++i) {
+        total += job->range_sum(job->ranges.items[i].start, job->ranges.items[i].end);
+    }
+    return total;
+}
+
+static size_t ranges_total_parallel(IdRangeArray *ira, RangeSumFn range_sum, Arena *scratch) {
+    RangeJob job = { .ranges = ira_merged(ira, scratch), .range_sum = range_sum };
+    uint128_t total = pool_sum_slices(job.ranges.size, RANGE_TASKS_PER_THREAD, range_slice_sum, &job, scratch);
+    return answer_narrow(total, "invalid ID sum");
+}
+
+static size_t part1_parallel(void *input, Arena *scratch) {
+    return ranges_total_parallel(input, range_sum_halves, scratch);
+}
+
+static size_t part2_parallel(void *input, Arena *scratch) {
+    return ranges_total_parallel(input, range_sum_repeats, scratch);
+}
+
+static const Variant variants[] = {
+    { .name = "enumerate", .part1 = part1_enumerate, .part2 = part2_enumerate },
+    { .name = "parallel", .part1 = part1_parallel, .part2 = part2_parallel },
+};
+
+static void *parse(Arena *arena, char *file_path) {
+    return ira_from(arena, file_path);
+}
+
+const Day day02 = {
+    .name = "day02",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .variants = variants,
+    .variants_count = sizeof(variants) / sizeof(variants[0]),
+    .test1 = 1227775554,
+    .test2 = 4174379265
+};
+
+#ifndef AOC_RUNNER
 int main() {
-    assert(part1("day02/test.txt") == 1227775554);
-    assert(part2("day02/test.txt") == 4174379265);
+    Arena arena = {0};
+
+    IdRangeArray *test = parse(&arena, "day02/test.txt");
+    assert(part1(test, &arena) == 1227775554);
+    assert(part2(test, &arena) == 4174379265);
+    assert(part1_enumerate(test, &arena) == 1227775554);
+    assert(part2_enumerate(test, &arena) == 4174379265);
+    assert(part1_parallel(test, &arena) == 1227775554);
+    assert(part2_parallel(test, &arena) == 4174379265);
+
+    IdRange from_zero_range = { .start = 0, .end = 100 };
+    IdRangeArray from_zero = { .items = &from_zero_range, .size = 1, .capacity = 1 };
+    assert(part1(&from_zero, &arena) == 495);
+    assert(part2(&from_zero, &arena) == 495);
+    assert(part1_enumerate(&from_zero, &arena) == 495);
+    assert(part2_enumerate(&from_zero, &arena) == 495);
+    assert(part1_parallel(&from_zero, &arena) == 495);
+    assert(part2_parallel(&from_zero, &arena) == 495);
+    arena_reset(&arena);
+
+    IdRangeArray *input = parse(&arena, "day02/input.txt");
+    printf("Invalid ID sum: %zu\n", part1(input, &arena));
+    printf("Invalid ID sum (new rules): %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
-    printf("Invalid ID sum: %zu\n", part1("day02/input.txt"));
-    printf("Invalid ID sum (new rules): %zu\n", part2("day02/input.txt"));
     return 0;
 }
+#endif // AOC_RUNNER
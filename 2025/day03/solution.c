@@ -3,97 +3,342 @@
 #include <stdio.h>
 #include <assert.h>
 
-#define BATTERY_BANK_CAPACITY 128
-#define BATTERY_BANK_ARRAY_CAPACITY 1024
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
+#include "../common/pool.h"
+
+// Largest joltage that still fits a uint128_t.
+#define BANK_MAX_ON_COUNT 38
+
+// One digit per byte. The banks of a file are slices of a single buffer
+// owned by the BatteryBankArray.
 typedef struct {
-    size_t batteries[BATTERY_BANK_CAPACITY];
+    uint8_t *batteries;
     size_t size;
 } BatteryBank;
 
-BatteryBank bb_from_string(char *string) {
-    BatteryBank bb = { .batteries = {0}, .size = 0 };
-    size_t size = 0;
-    while (1) {
-        if (string[size] == '\n') break;
-        bb.batteries[size] = (size_t)string[size] - 48;
-        size++;
+static BatteryBank bb_from_line(uint8_t *digits, Span line) {
+    for (size_t i = 0; i < line.size; ++i) {
+        digits[i] = (uint8_t)(line.data[i] - '0');
     }
-    bb.size = size;
-    return bb;
+    return (BatteryBank) { .batteries = digits, .size = line.size };
 }
 
-size_t bb_max_joltage(BatteryBank *bb, size_t on_count) {
-    size_t max_joltage = 0;
+// Index of the first largest digit in batteries[0..size). Whole registers
+// are only inspected further when they hold a digit above the current best,
+// and the scan stops at the first 9 since nothing can beat it.
+static size_t bb_window_max(const uint8_t *batteries, size_t size) {
     size_t max_index = 0;
+    uint8_t max = batteries[0];
+    size_t i = 1;
+#if defined(__AVX2__)
+    for (; max < 9 && i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(batteries + i));
+        __m256i above = _mm256_set1_epi8((char)(max + 1));
+        __m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(block, above), block);
+        if (_mm256_movemask_epi8(ge) == 0) continue;
 
-    for (size_t i = 0; i < on_count; ++i) {
-        for (size_t j = max_index + 1; j <= bb->size - on_count + i; ++j) {
-            if (bb->batteries[j] > bb->batteries[max_index]) {
-                max_index = j;
-            }
+        __m128i half = _mm_max_epu8(_mm256_castsi256_si128(block), _mm256_extracti128_si256(block, 1));
+        half = _mm_max_epu8(half, _mm_srli_si128(half, 8));
+        half = _mm_max_epu8(half, _mm_srli_si128(half, 4));
+        half = _mm_max_epu8(half, _mm_srli_si128(half, 2));
+        half = _mm_max_epu8(half, _mm_srli_si128(half, 1));
+        max = (uint8_t)_mm_cvtsi128_si32(half);
+
+        __m256i eq = _mm256_cmpeq_epi8(block, _mm256_set1_epi8((char)max));
+        max_index = i + (size_t)__builtin_ctz((uint32_t)_mm256_movemask_epi8(eq));
+    }
+#endif
+    for (; max < 9 && i < size; ++i) {
+        if (batteries[i] > max) {
+            max = batteries[i];
+            max_index = i;
         }
+    }
+    return max_index;
+}
+
+// Picks the first largest digit of every remaining window, O(size * on_count).
+static uint128_t bb_max_joltage_rescan(BatteryBank *bb, size_t on_count) {
+    assert(on_count <= bb->size && on_count <= BANK_MAX_ON_COUNT);
+    uint128_t max_joltage = 0;
+    size_t start = 0;
+
+    for (size_t i = 0; i < on_count; ++i) {
+        size_t window = bb->size - on_count + i + 1 - start;
+        size_t max_index = start + bb_window_max(bb->batteries + start, window);
         max_joltage = max_joltage * 10 + bb->batteries[max_index];
-        max_index++;
+        start = max_index + 1;
+    }
+    return max_joltage;
+}
+
+// Greedy monotonic stack, O(size) for any on_count. A digit pops every
+// smaller digit before it while enough digits remain to fill the stack, so
+// the stack always holds the largest subsequence seen so far.
+static uint128_t bb_max_joltage(BatteryBank *bb, size_t on_count, uint8_t *stack) {
+    assert(on_count <= bb->size && on_count <= BANK_MAX_ON_COUNT);
+    size_t drops = bb->size - on_count;
+    size_t top = 0;
+
+    for (size_t i = 0; i < bb->size; ++i) {
+        uint8_t battery = bb->batteries[i];
+        while (top > 0 && drops > 0 && stack[top - 1] < battery) {
+            top--;
+            drops--;
+        }
+        if (top < on_count) {
+            stack[top++] = battery;
+        } else {
+            drops--;
+        }
+    }
+
+    uint128_t max_joltage = 0;
+    for (size_t i = 0; i < on_count; ++i) {
+        max_joltage = max_joltage * 10 + stack[i];
     }
     return max_joltage;
 }
 
 typedef struct {
-    BatteryBank items[BATTERY_BANK_ARRAY_CAPACITY];
+    BatteryBank *items;
     size_t size;
+    size_t capacity;
+    uint8_t *digits;
+    size_t digits_size;
 } BatteryBankArray;
 
-void bba_push_from_string(BatteryBankArray *bba, char *string) {
-    assert(bba->size != BATTERY_BANK_ARRAY_CAPACITY);
-    bba->items[bba->size] = bb_from_string(string);
-    bba->size++;
+static void bba_push_from_line(Arena *arena, BatteryBankArray *bba, Span line) {
+    BatteryBank bb = bb_from_line(bba->digits + bba->digits_size, line);
+    bba->digits_size += line.size;
+    arena_da_append(arena, bba, bb);
 }
 
-BatteryBankArray bba_from_file(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
-        exit(1);
-    }
+static BatteryBankArray *bba_from_file(Arena *arena, char *file_path) {
+    Span input = input_map(file_path);
 
-    BatteryBankArray bba = {
-        .items = { { .batteries = {0}, .size = 0 } },
-        .size = 0
-    };
+    BatteryBankArray *bba = arena_alloc(arena, sizeof(BatteryBankArray));
+    *bba = (BatteryBankArray) {0};
 
+    // The digits never outnumber the input bytes, only the newlines are
+    // left unused at the end of the buffer.
+    bba->digits = arena_alloc(arena, input.size + 1);
 
-    char line[BATTERY_BANK_CAPACITY];
-    while (fgets(line, BATTERY_BANK_CAPACITY, fp) != NULL) {
-       bba_push_from_string(&bba, line);
+    Lines lines = lines_from_span(input);
+    Span line;
+    while (lines_next(&lines, &line)) {
+        if (line.size == 0) continue;
+        bba_push_from_line(arena, bba, line);
     }
+    input_unmap(input);
     return bba;
 }
 
-size_t bba_total_output_joltage(BatteryBankArray *bba, size_t on_count) {
-    size_t total = 0;
+// A bank can reach 10^38, so a few of them already pass 128 bits. Such a
+// total is an error rather than a wrapped one.
+static void joltage_add(uint128_t *total, uint128_t joltage) {
+    if (__builtin_add_overflow(*total, joltage, total)) {
+        fprintf(stderr, "ERROR: total output joltage does not fit in 128 bits\n");
+        exit(1);
+    }
+}
+
+// Banks are independent, so any slice of them can be summed on its own.
+typedef struct {
+    BatteryBankArray *bba;
+    size_t on_count;
+} BankJob;
+
+static uint128_t bank_slice_sum(void *ctx, size_t beg, size_t end) {
+    BankJob *job = ctx;
+    uint8_t stack[BANK_MAX_ON_COUNT];
+    uint128_t total = 0;
+    for (size_t i = beg; i < end; ++i) {
+        joltage_add(&total, bb_max_joltage(&job->bba->items[i], job->on_count, stack));
+    }
+    return total;
+}
+
+static uint128_t bba_total_output_joltage(BatteryBankArray *bba, size_t on_count) {
+    BankJob job = { .bba = bba, .on_count = on_count };
+    return bank_slice_sum(&job, 0, bba->size);
+}
+
+#define BANK_TASKS_PER_THREAD 8
+
+static uint128_t bba_total_output_joltage_parallel(BatteryBankArray *bba, size_t on_count, Arena *scratch) {
+    BankJob job = { .bba = bba, .on_count = on_count };
+    return pool_sum_slices(bba->size, BANK_TASKS_PER_THREAD, bank_slice_sum, &job, scratch);
+}
+
+static uint128_t bba_total_output_joltage_rescan(BatteryBankArray *bba, size_t on_count) {
+    uint128_t total = 0;
     for (size_t i = 0; i < bba->size; ++i) {
-        total += bb_max_joltage(&bba->items[i], on_count);
+        joltage_add(&total, bb_max_joltage_rescan(&bba->items[i], on_count));
     }
     return total;
 }
 
-size_t part1(char *file_path) {
-    BatteryBankArray bba = bba_from_file(file_path);
-    return bba_total_output_joltage(&bba, 2);
+// Largest bank joltage that still fits a size_t, totals are kept in 128 bits.
+#define STREAM_MAX_ON_COUNT 19
+#define STREAM_BUFFER_SIZE (64 * 1024)
+
+// Best joltage of every length over the digits of the current bank so far.
+// best[j] is only valid once seen >= j.
+typedef struct {
+    size_t best[STREAM_MAX_ON_COUNT + 1];
+    size_t seen;
+    size_t max_on_count;
+} BankStream;
+
+static void bank_stream_push(BankStream *bs, uint8_t battery) {
+    size_t top = bs->seen < bs->max_on_count ? bs->seen + 1 : bs->max_on_count;
+    if (top > bs->seen) bs->best[top] = 0;
+    for (size_t j = top; j > 0; --j) {
+        size_t joltage = bs->best[j - 1] * 10 + battery;
+        if (joltage > bs->best[j]) bs->best[j] = joltage;
+    }
+    bs->seen++;
+}
+
+static void bank_stream_finish(BankStream *bs, const size_t *on_counts, size_t count, uint128_t *totals) {
+    if (bs->seen == 0) return;
+    for (size_t i = 0; i < count; ++i) {
+        assert(on_counts[i] <= bs->seen);
+        totals[i] += bs->best[on_counts[i]];
+    }
+    bs->seen = 0;
 }
 
-size_t part2(char *file_path) {
-    BatteryBankArray bba = bba_from_file(file_path);
-    return bba_total_output_joltage(&bba, 12);
+// Folds every bank of the file into totals[i] for each on_counts[i] while
+// reading it in fixed-size blocks. Memory use does not depend on the file
+// size or on the length of its lines.
+static void bba_stream_totals(char *file_path, const size_t *on_counts, size_t count, uint128_t *totals) {
+    BankStream bs = { .best = {0}, .seen = 0, .max_on_count = 0 };
+    for (size_t i = 0; i < count; ++i) {
+        assert(on_counts[i] > 0 && on_counts[i] <= STREAM_MAX_ON_COUNT);
+        if (on_counts[i] > bs.max_on_count) bs.max_on_count = on_counts[i];
+        totals[i] = 0;
+    }
+
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
+        exit(1);
+    }
+
+    static char buffer[STREAM_BUFFER_SIZE];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (size_t i = 0; i < read; ++i) {
+            char c = buffer[i];
+            if (c == '\n') {
+                bank_stream_finish(&bs, on_counts, count, totals);
+            } else if (c >= '0' && c <= '9') {
+                bank_stream_push(&bs, (uint8_t)(c - '0'));
+            }
+        }
+    }
+    if (ferror(file)) {
+        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
+        exit(1);
+    }
+    fclose(file);
+    bank_stream_finish(&bs, on_counts, count, totals);
 }
 
-int main() {
-    assert(part1("day03/test.txt") == 357);
-    assert(part2("day03/test.txt") == 3121910778619);
+static size_t part1(void *input, Arena *scratch) {
+    (void)scratch;
+    BatteryBankArray *bba = input;
+    return answer_narrow(bba_total_output_joltage(bba, 2), "total output joltage");
+}
+
+static size_t part2(void *input, Arena *scratch) {
+    (void)scratch;
+    BatteryBankArray *bba = input;
+    return answer_narrow(bba_total_output_joltage(bba, 12), "total output joltage");
+}
+
+static size_t part1_rescan(void *input, Arena *scratch) {
+    (void)scratch;
+    BatteryBankArray *bba = input;
+    return answer_narrow(bba_total_output_joltage_rescan(bba, 2), "total output joltage");
+}
+
+static size_t part2_rescan(void *input, Arena *scratch) {
+    (void)scratch;
+    BatteryBankArray *bba = input;
+    return answer_narrow(bba_total_output_joltage_rescan(bba, 12), "total output joltage");
+}
+
+static size_t part1_parallel(void *input, Arena *scratch) {
+    BatteryBankArray *bba = input;
+    return answer_narrow(bba_total_output_joltage_parallel(bba, 2, scratch), "total output joltage");
+}
+
+static size_t part2_parallel(void *input, Arena *scratch) {
+    BatteryBankArray *bba = input;
+    return answer_narrow(bba_total_output_joltage_parallel(bba, 12, scratch), "total output joltage");
+}
+
+static const Variant variants[] = {
+    { .name = "rescan", .part1 = part1_rescan, .part2 = part2_rescan },
+    { .name = "parallel", .part1 = part1_parallel, .part2 = part2_parallel },
+};
+
+static void *parse(Arena *arena, char *file_path) {
+    return bba_from_file(arena, file_path);
+}
+
+const Day day03 = {
+    .name = "day03",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .variants = variants,
+    .variants_count = sizeof(variants) / sizeof(variants[0]),
+    .test1 = 357,
+    .test2 = 3121910778619
+};
+
+#ifndef AOC_RUNNER
+// With a file argument the banks are streamed instead of loaded, so inputs
+// of any size can be solved.
+int main(int argc, char **argv) {
+    const size_t on_counts[] = { 2, 12 };
+    uint128_t totals[2];
+
+    if (argc > 1) {
+        bba_stream_totals(argv[1], on_counts, 2, totals);
+        printf("Total output joltage (2): %zu\n", answer_narrow(totals[0], "total output joltage"));
+        printf("Total output joltage (12): %zu\n", answer_narrow(totals[1], "total output joltage"));
+        return 0;
+    }
+
+    Arena arena = {0};
+
+    BatteryBankArray *test = parse(&arena, "day03/test.txt");
+    assert(part1(test, &arena) == 357);
+    assert(part2(test, &arena) == 3121910778619);
+    assert(part1_rescan(test, &arena) == 357);
+    assert(part2_rescan(test, &arena) == 3121910778619);
+    assert(part1_parallel(test, &arena) == 357);
+    assert(part2_parallel(test, &arena) == 3121910778619);
+    bba_stream_totals("day03/test.txt", on_counts, 2, totals);
+    assert(totals[0] == 357 && totals[1] == 3121910778619);
+    arena_reset(&arena);
 
-    printf("Total output joltage (2): %zu\n", part1("day03/input.txt"));
-    printf("Total output joltage (12): %zu\n", part2("day03/input.txt"));
+    BatteryBankArray *input = parse(&arena, "day03/input.txt");
+    printf("Total output joltage (2): %zu\n", part1(input, &arena));
+    printf("Total output joltage (12): %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
     return 0;
 }
+#endif // AOC_RUNNER
@@ -1,41 +1,68 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
-#define PAPER_ROLLS_CAPACITY 32768
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
+#include "../common/pool.h"
 
+// One bit per cell, bit j % 64 of word 1 + j / 64 holds column j. Every row
+// is padded with a zero word on both sides and the grid with a zero row above
+// and below, so neighbors never need bounds checks.
 typedef struct {
-    int paper_rolls[PAPER_ROLLS_CAPACITY];
-    int height;
-    int width;
+    uint64_t *words;
+    size_t stride;
+    size_t height;
+    size_t width;
 } PaperRollMap;
 
-PaperRollMap prm_from_file(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR_ unable to read file %s\n", file_path);
-        exit(1);
-    }
+// Row i of the map, -1 and height are the zero border rows.
+static uint64_t *prm_row(PaperRollMap *prm, ptrdiff_t i) {
+    return prm->words + (size_t)(i + 1) * prm->stride + 1;
+}
+
+static int prm_get(PaperRollMap *prm, size_t i, size_t j) {
+    return (prm_row(prm, i)[j / 64] >> (j % 64)) & 1;
+}
+
+static void prm_clear(PaperRollMap *prm, size_t i, size_t j) {
+    prm_row(prm, i)[j / 64] &= ~((uint64_t)1 << (j % 64));
+}
+
+static size_t prm_words_size(PaperRollMap *prm) {
+    return (prm->height + 2) * prm->stride * sizeof(uint64_t);
+}
 
-    PaperRollMap prm = { .paper_rolls = {0}, .height = 0, .width = 0 };
+static PaperRollMap *prm_from_file(Arena *arena, char *file_path) {
+    Span input = input_map(file_path);
 
-    int size = 0;
-    int height = 0;
-    char c;
+    PaperRollMap *prm = arena_alloc(arena, sizeof(PaperRollMap));
+    const char *newline = memchr(input.data, '\n', input.size);
+    size_t width = newline == NULL ? input.size : (size_t)(newline - input.data);
+    assert(width > 0);
+    size_t height = (input.size + 1) / (width + 1);
+    *prm = (PaperRollMap) { .words = NULL, .stride = (width + 63) / 64 + 2, .height = height, .width = width };
+    prm->words = arena_alloc(arena, prm_words_size(prm));
+    memset(prm->words, 0, prm_words_size(prm));
 
-    while ((c = fgetc(fp)) != EOF) {
-        switch (c) {
+    size_t i = 0;
+    size_t j = 0;
+    for (size_t k = 0; k < input.size; ++k) {
+        switch (input.data[k]) {
             case '@':
-                prm.paper_rolls[size] = 1;
-                size++;
+                prm_row(prm, i)[j / 64] |= (uint64_t)1 << (j % 64);
+                j++;
                 break;
             case '.':
-                prm.paper_rolls[size] = 0;
-                size++;
+                j++;
                 break;
             case '\n':
-                height++;
+                assert(j == width);
+                i++;
+                j = 0;
                 break;
             default:
                 fprintf(stderr, "ERROR: unreachable state\n");
@@ -43,39 +70,38 @@ PaperRollMap prm_from_file(char *file_path) {
                 break;
         }
     }
-    assert(size % height == 0);
-    prm.height = height;
-    prm.width = size / height;
+    input_unmap(input);
+    assert(i + (j > 0) == height);
     return prm;
 }
 
-void prm_print(PaperRollMap *prm) {
-    printf("heigth=%d\n", prm->height);
-    printf("width=%d\n", prm->width);
-    for (int i = 0; i < prm->height; ++i) {
-        for (int j = 0; j < prm->width; ++j) {
-            printf("%d ", prm->paper_rolls[i * prm->width + j]);
+static void prm_print(PaperRollMap *prm) {
+    printf("heigth=%zu\n", prm->height);
+    printf("width=%zu\n", prm->width);
+    for (size_t i = 0; i < prm->height; ++i) {
+        for (size_t j = 0; j < prm->width; ++j) {
+            printf("%d ", prm_get(prm, i, j));
         }
         printf("\n");
     }
 }
 
-int prm_count_neighbors(PaperRollMap *prm, int i, int j) {
+static int prm_count_neighbors(PaperRollMap *prm, size_t i, size_t j) {
     int neighbors = 0;
     for (int i_offset = -1; i_offset <= 1; ++i_offset) {
         for (int j_offset = -1; j_offset <= 1; ++j_offset) {
             if (i_offset == 0 && j_offset == 0) {
                 continue;
             }
-            int new_i = i + i_offset;
-            int new_j = j + j_offset;
-            if (new_i < 0 || new_i >= prm->width) {
+            ptrdiff_t new_i = (ptrdiff_t)i + i_offset;
+            ptrdiff_t new_j = (ptrdiff_t)j + j_offset;
+            if (new_i < 0 || new_i >= (ptrdiff_t)prm->height) {
                 continue;
             }
-            if (new_j < 0 || new_j >= prm->height) {
+            if (new_j < 0 || new_j >= (ptrdiff_t)prm->width) {
                 continue;
             }
-            if (prm->paper_rolls[new_i * prm->width + new_j]) {
+            if (prm_get(prm, new_i, new_j)) {
                 neighbors++;
             }
         }
@@ -83,11 +109,333 @@ int prm_count_neighbors(PaperRollMap *prm, int i, int j) {
     return neighbors;
 }
 
-int prm_total_accessible(PaperRollMap *prm) {
-    int total_accessible = 0;
-    for (int i = 0; i < prm->height; ++i) {
-        for (int j = 0; j < prm->width; ++j) {
-            if (prm->paper_rolls[i * prm->width + j] == 0) {
+// Cells of word w with at least 4 of their 8 neighbors set. The neighbors
+// are added up bit-sliced: three full adders give the ones and four bits of
+// weight two, and the count reaches 4 once two of those four are set.
+static uint64_t prm_crowded(const uint64_t *up, const uint64_t *mid, const uint64_t *down, size_t w) {
+    uint64_t ul = (up[w] << 1) | (up[w - 1] >> 63);
+    uint64_t ur = (up[w] >> 1) | (up[w + 1] << 63);
+    uint64_t dl = (down[w] << 1) | (down[w - 1] >> 63);
+    uint64_t dr = (down[w] >> 1) | (down[w + 1] << 63);
+    uint64_t l = (mid[w] << 1) | (mid[w - 1] >> 63);
+    uint64_t r = (mid[w] >> 1) | (mid[w + 1] << 63);
+
+    uint64_t up_ones = ul ^ up[w] ^ ur;
+    uint64_t up_twos = (ul & up[w]) | (ur & (ul ^ up[w]));
+    uint64_t down_ones = dl ^ down[w] ^ dr;
+    uint64_t down_twos = (dl & down[w]) | (dr & (dl ^ down[w]));
+    uint64_t mid_ones = l ^ r;
+    uint64_t mid_twos = l & r;
+    uint64_t ones_twos = (up_ones & down_ones) | (mid_ones & (up_ones ^ down_ones));
+
+    uint64_t a = up_twos, b = down_twos, c = mid_twos, d = ones_twos;
+    return ((a | b) & (c | d)) | (a & b) | (c & d);
+}
+
+static size_t prm_total_accessible(PaperRollMap *prm) {
+    size_t words = prm->stride - 2;
+    size_t total_accessible = 0;
+    for (size_t i = 0; i < prm->height; ++i) {
+        const uint64_t *up = prm_row(prm, (ptrdiff_t)i - 1);
+        const uint64_t *mid = prm_row(prm, i);
+        const uint64_t *down = prm_row(prm, i + 1);
+        for (size_t w = 0; w < words; ++w) {
+            total_accessible += __builtin_popcountll(mid[w] & ~prm_crowded(up, mid, down, w));
+        }
+    }
+    return total_accessible;
+}
+
+// Rolls are removed in place while sweeping, so a sweep already sees the
+// rolls removed earlier in it. Removing a roll only ever frees others, which
+// makes the total independent of the order. A cascade running up the grid
+// still costs a whole sweep per row, which prm_total_removed avoids.
+static size_t prm_total_removed_sweep(PaperRollMap *original, Arena *scratch) {
+    PaperRollMap prm = *original;
+    prm.words = arena_alloc(scratch, prm_words_size(original));
+    memcpy(prm.words, original->words, prm_words_size(original));
+
+    size_t words = prm.stride - 2;
+    size_t total_removed = 0;
+    int searching = 1;
+    while (searching) {
+        searching = 0;
+        for (size_t i = 0; i < prm.height; ++i) {
+            const uint64_t *up = prm_row(&prm, (ptrdiff_t)i - 1);
+            uint64_t *mid = prm_row(&prm, i);
+            const uint64_t *down = prm_row(&prm, i + 1);
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t removed = mid[w] & ~prm_crowded(up, mid, down, w);
+                if (removed == 0) continue;
+                mid[w] &= ~removed;
+                total_removed += __builtin_popcountll(removed);
+                searching = 1;
+            }
+        }
+    }
+    return total_removed;
+}
+
+#define CELL_ROLL 0x10
+#define CELL_NEIGHBORS 0x0f
+
+// Called once per generation with the rolls it removed, as row * width + col
+// in no particular order. Generation 1 removes the rolls accessible at the
+// start, generation n + 1 those accessible once generation n is gone.
+typedef void (*GenerationFn)(void *ctx, size_t generation, size_t *removed, size_t count);
+
+// Counts every roll's neighbors once, then only revisits the neighbors of
+// removed rolls. A roll is taken off the grid when it is queued, so it is
+// queued at most once and the work is linear in the number of cells. The
+// queue is consumed one generation at a time, which is what on_generation
+// sees, and on_generation may be NULL.
+static size_t prm_remove_generations(PaperRollMap *prm, Arena *scratch, GenerationFn on_generation, void *ctx) {
+    // Cell bytes hold CELL_ROLL and the neighbor count, with a zero border
+    // so that the 8 neighbor offsets are always valid.
+    size_t stride = prm->width + 2;
+    uint8_t *cells = arena_alloc(scratch, (prm->height + 2) * stride);
+    memset(cells, 0, (prm->height + 2) * stride);
+    const ptrdiff_t offsets[8] = {
+        -(ptrdiff_t)stride - 1, -(ptrdiff_t)stride, -(ptrdiff_t)stride + 1, -1,
+        1, (ptrdiff_t)stride - 1, (ptrdiff_t)stride, (ptrdiff_t)stride + 1
+    };
+
+    size_t rolls = 0;
+    for (size_t i = 0; i < prm->height; ++i) {
+        const uint64_t *row = prm_row(prm, i);
+        for (size_t w = 0; w < prm->stride - 2; ++w) {
+            for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1) {
+                size_t k = (i + 1) * stride + w * 64 + __builtin_ctzll(bits) + 1;
+                cells[k] |= CELL_ROLL;
+                for (size_t n = 0; n < 8; ++n) {
+                    cells[k + offsets[n]]++;
+                }
+                rolls++;
+            }
+        }
+    }
+
+    size_t *queue = arena_alloc(scratch, rolls * sizeof(size_t));
+    size_t tail = 0;
+    for (size_t k = stride; k < (prm->height + 1) * stride; ++k) {
+        if ((cells[k] & CELL_ROLL) && (cells[k] & CELL_NEIGHBORS) < 4) {
+            cells[k] &= ~CELL_ROLL;
+            queue[tail++] = k;
+        }
+    }
+
+    size_t head = 0;
+    for (size_t generation = 1; head < tail; ++generation) {
+        size_t generation_beg = head;
+        size_t generation_end = tail;
+        for (; head < generation_end; ++head) {
+            size_t k = queue[head];
+            for (size_t n = 0; n < 8; ++n) {
+                size_t neighbor = k + offsets[n];
+                cells[neighbor]--;
+                if (cells[neighbor] == (CELL_ROLL | 3)) {
+                    cells[neighbor] &= ~CELL_ROLL;
+                    queue[tail++] = neighbor;
+                }
+            }
+        }
+        if (on_generation == NULL) continue;
+
+        // This generation is done with, its queue entries can be rewritten.
+        size_t *removed = queue + generation_beg;
+        size_t count = generation_end - generation_beg;
+        for (size_t r = 0; r < count; ++r) {
+            removed[r] = (removed[r] / stride - 1) * prm->width + removed[r] % stride - 1;
+        }
+        on_generation(ctx, generation, removed, count);
+    }
+    return tail;
+}
+
+static size_t prm_total_removed(PaperRollMap *prm, Arena *scratch) {
+    return prm_remove_generations(prm, scratch, NULL, NULL);
+}
+
+static void varint_write(FILE *file, size_t value) {
+    while (value >= 0x80) {
+        putc_unlocked((int)(value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    putc_unlocked((int)value, file);
+}
+
+static int compare_size(const void *a, const void *b) {
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Generations are written as LEB128 varints: the height and the width, then
+// per generation the number of rolls removed followed by their sorted
+// row * width + col positions, each as the difference to the previous one.
+// A count of 0 ends the stream.
+static void generation_write(void *ctx, size_t generation, size_t *removed, size_t count) {
+    (void)generation;
+    FILE *file = ctx;
+    qsort(removed, count, sizeof(size_t), compare_size);
+    varint_write(file, count);
+    size_t previous = 0;
+    for (size_t r = 0; r < count; ++r) {
+        varint_write(file, removed[r] - previous);
+        previous = removed[r];
+    }
+}
+
+static size_t prm_write_generations(PaperRollMap *prm, Arena *scratch, FILE *file) {
+    varint_write(file, prm->height);
+    varint_write(file, prm->width);
+    size_t total_removed = prm_remove_generations(prm, scratch, generation_write, file);
+    varint_write(file, 0);
+    return total_removed;
+}
+
+// A tile is TILE_ROWS rows of TILE_WORDS words, 16 KiB of cells. Tiles only
+// read the rows and words around them, so they need no halo copies.
+#define TILE_ROWS 128
+#define TILE_WORDS 16
+
+// Removal runs in synchronous generations: every tile computes its next
+// state from the current one into a second buffer, and the new state is
+// copied back once all tiles are done. That makes the result independent of
+// the thread count. Only tiles next to a tile that changed are stepped again.
+typedef struct {
+    PaperRollMap *prm;
+    uint64_t *next;
+    size_t tiles_across;
+    size_t tiles_down;
+    size_t *tiles;
+    size_t *removed;
+    uint8_t *changed;
+} TileJob;
+
+static void tile_bounds(TileJob *job, size_t tile, size_t *row_beg, size_t *row_end, size_t *word_beg, size_t *word_end) {
+    size_t words = job->prm->stride - 2;
+    *row_beg = tile / job->tiles_across * TILE_ROWS;
+    *row_end = *row_beg + TILE_ROWS < job->prm->height ? *row_beg + TILE_ROWS : job->prm->height;
+    *word_beg = tile % job->tiles_across * TILE_WORDS;
+    *word_end = *word_beg + TILE_WORDS < words ? *word_beg + TILE_WORDS : words;
+}
+
+// Counts the accessible rolls of a tile, and writes the tile without them to
+// the next buffer unless only counting.
+static void tile_step_task(void *ctx, size_t task) {
+    TileJob *job = ctx;
+    size_t row_beg, row_end, word_beg, word_end;
+    tile_bounds(job, job->tiles[task], &row_beg, &row_end, &word_beg, &word_end);
+
+    size_t removed = 0;
+    for (size_t i = row_beg; i < row_end; ++i) {
+        const uint64_t *up = prm_row(job->prm, (ptrdiff_t)i - 1);
+        const uint64_t *mid = prm_row(job->prm, i);
+        const uint64_t *down = prm_row(job->prm, i + 1);
+        uint64_t *next = job->next + (mid - job->prm->words);
+        for (size_t w = word_beg; w < word_end; ++w) {
+            uint64_t crowded = prm_crowded(up, mid, down, w);
+            removed += __builtin_popcountll(mid[w] & ~crowded);
+            if (job->next != NULL) next[w] = mid[w] & crowded;
+        }
+    }
+    job->removed[task] = removed;
+    if (job->next != NULL) job->changed[job->tiles[task]] = removed > 0;
+}
+
+static void tile_commit_task(void *ctx, size_t task) {
+    TileJob *job = ctx;
+    if (!job->changed[job->tiles[task]]) return;
+
+    size_t row_beg, row_end, word_beg, word_end;
+    tile_bounds(job, job->tiles[task], &row_beg, &row_end, &word_beg, &word_end);
+    for (size_t i = row_beg; i < row_end; ++i) {
+        uint64_t *mid = prm_row(job->prm, i);
+        uint64_t *next = job->next + (mid - job->prm->words);
+        memcpy(mid + word_beg, next + word_beg, (word_end - word_beg) * sizeof(uint64_t));
+    }
+}
+
+static TileJob tile_job_new(PaperRollMap *prm, Arena *scratch) {
+    TileJob job = { .prm = prm, .next = NULL };
+    job.tiles_across = (prm->stride - 2 + TILE_WORDS - 1) / TILE_WORDS;
+    job.tiles_down = (prm->height + TILE_ROWS - 1) / TILE_ROWS;
+    size_t tiles_count = job.tiles_across * job.tiles_down;
+    job.tiles = arena_alloc(scratch, tiles_count * sizeof(size_t));
+    job.removed = arena_alloc(scratch, tiles_count * sizeof(size_t));
+    for (size_t t = 0; t < tiles_count; ++t) {
+        job.tiles[t] = t;
+    }
+    return job;
+}
+
+static size_t tile_job_sum(TileJob *job, size_t tiles_count) {
+    size_t total = 0;
+    for (size_t t = 0; t < tiles_count; ++t) {
+        total += job->removed[t];
+    }
+    return total;
+}
+
+static size_t prm_total_accessible_parallel(PaperRollMap *prm, Arena *scratch) {
+    TileJob job = tile_job_new(prm, scratch);
+    size_t tiles_count = job.tiles_across * job.tiles_down;
+    pool_run(tiles_count, tile_step_task, &job);
+    return tile_job_sum(&job, tiles_count);
+}
+
+static int tile_near_change(TileJob *job, size_t tile) {
+    size_t ti = tile / job->tiles_across;
+    size_t tj = tile % job->tiles_across;
+    for (size_t i = ti > 0 ? ti - 1 : 0; i <= ti + 1 && i < job->tiles_down; ++i) {
+        for (size_t j = tj > 0 ? tj - 1 : 0; j <= tj + 1 && j < job->tiles_across; ++j) {
+            if (job->changed[i * job->tiles_across + j]) return 1;
+        }
+    }
+    return 0;
+}
+
+static size_t prm_total_removed_parallel(PaperRollMap *original, Arena *scratch) {
+    PaperRollMap prm = *original;
+    prm.words = arena_alloc(scratch, prm_words_size(original));
+    memcpy(prm.words, original->words, prm_words_size(original));
+
+    TileJob job = tile_job_new(&prm, scratch);
+    size_t tiles_count = job.tiles_across * job.tiles_down;
+    job.next = arena_alloc(scratch, prm_words_size(original));
+    job.changed = arena_alloc(scratch, tiles_count);
+    memset(job.changed, 0, tiles_count);
+    size_t *active = arena_alloc(scratch, tiles_count * sizeof(size_t));
+
+    size_t total_removed = 0;
+    size_t active_count = tiles_count;
+    while (active_count > 0) {
+        pool_run(active_count, tile_step_task, &job);
+        total_removed += tile_job_sum(&job, active_count);
+        pool_run(active_count, tile_commit_task, &job);
+
+        size_t next_count = 0;
+        for (size_t t = 0; t < tiles_count; ++t) {
+            if (tile_near_change(&job, t)) active[next_count++] = t;
+        }
+        for (size_t t = 0; t < active_count; ++t) {
+            job.changed[job.tiles[t]] = 0;
+        }
+        size_t *swap = job.tiles;
+        job.tiles = active;
+        active = swap;
+        active_count = next_count;
+    }
+    return total_removed;
+}
+
+// Cell by cell versions of both parts, kept as a reference.
+static size_t prm_total_accessible_scalar(PaperRollMap *prm) {
+    size_t total_accessible = 0;
+    for (size_t i = 0; i < prm->height; ++i) {
+        for (size_t j = 0; j < prm->width; ++j) {
+            if (prm_get(prm, i, j) == 0) {
                 continue;
             }
             if (prm_count_neighbors(prm, i, j) < 4) {
@@ -98,18 +446,22 @@ int prm_total_accessible(PaperRollMap *prm) {
     return total_accessible;
 }
 
-int prm_total_removed(PaperRollMap prm) {
-    int total_removed = 0;
+static size_t prm_total_removed_scalar(PaperRollMap *original, Arena *scratch) {
+    PaperRollMap prm = *original;
+    prm.words = arena_alloc(scratch, prm_words_size(original));
+    memcpy(prm.words, original->words, prm_words_size(original));
+
+    size_t total_removed = 0;
     int searching = 1;
     while (searching) {
         searching = 0;
-        for (int i = 0; i < prm.height; ++i) {
-            for (int j = 0; j < prm.width; ++j) {
-                if (prm.paper_rolls[i * prm.width + j] == 0) {
+        for (size_t i = 0; i < prm.height; ++i) {
+            for (size_t j = 0; j < prm.width; ++j) {
+                if (prm_get(&prm, i, j) == 0) {
                     continue;
                 }
                 if (prm_count_neighbors(&prm, i, j) < 4) {
-                    prm.paper_rolls[i * prm.width + j] = 0;
+                    prm_clear(&prm, i, j);
                     total_removed++;
                     searching = 1;
                 }
@@ -119,22 +471,112 @@ int prm_total_removed(PaperRollMap prm) {
     return total_removed;
 }
 
-int part1(char *file_path) {
-    PaperRollMap prm = prm_from_file(file_path);
-    return prm_total_accessible(&prm);
+static size_t part1(void *input, Arena *scratch) {
+    (void)scratch;
+    PaperRollMap *prm = input;
+    return prm_total_accessible(prm);
 }
 
-int part2(char *file_path) {
-    PaperRollMap prm = prm_from_file(file_path);
-    return prm_total_removed(prm);
+static size_t part2(void *input, Arena *scratch) {
+    PaperRollMap *prm = input;
+    return prm_total_removed(prm, scratch);
 }
 
-int main() {
-    assert(part1("day04/test.txt") == 13);
-    assert(part2("day04/test.txt") == 43);
+static size_t part2_sweep(void *input, Arena *scratch) {
+    PaperRollMap *prm = input;
+    return prm_total_removed_sweep(prm, scratch);
+}
+
+static size_t part1_parallel(void *input, Arena *scratch) {
+    PaperRollMap *prm = input;
+    return prm_total_accessible_parallel(prm, scratch);
+}
+
+static size_t part2_parallel(void *input, Arena *scratch) {
+    PaperRollMap *prm = input;
+    return prm_total_removed_parallel(prm, scratch);
+}
+
+static size_t part1_scalar(void *input, Arena *scratch) {
+    (void)scratch;
+    PaperRollMap *prm = input;
+    return prm_total_accessible_scalar(prm);
+}
+
+static size_t part2_scalar(void *input, Arena *scratch) {
+    PaperRollMap *prm = input;
+    return prm_total_removed_scalar(prm, scratch);
+}
+
+static const Variant variants[] = {
+    { .name = "scalar", .part1 = part1_scalar, .part2 = part2_scalar },
+    { .name = "sweep", .part1 = part1, .part2 = part2_sweep },
+    { .name = "parallel", .part1 = part1_parallel, .part2 = part2_parallel },
+};
+
+static void *parse(Arena *arena, char *file_path) {
+    return prm_from_file(arena, file_path);
+}
+
+const Day day04 = {
+    .name = "day04",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .variants = variants,
+    .variants_count = sizeof(variants) / sizeof(variants[0]),
+    .test1 = 13,
+    .test2 = 43
+};
+
+#ifndef AOC_RUNNER
+static void generation_check(void *ctx, size_t generation, size_t *removed, size_t count) {
+    (void)removed;
+    size_t *counts = ctx;
+    assert(generation < 16);
+    counts[generation] = count;
+}
+
+// With an input and an output file, the removal generations of the input
+// are written to the output as described at generation_write.
+int main(int argc, char **argv) {
+    Arena arena = {0};
+
+    if (argc > 2) {
+        PaperRollMap *prm = parse(&arena, argv[1]);
+        FILE *file = fopen(argv[2], "wb");
+        if (file == NULL) {
+            fprintf(stderr, "ERROR: unable to write file %s\n", argv[2]);
+            exit(1);
+        }
+        setvbuf(file, NULL, _IOFBF, 1 << 20);
+        printf("Removable rolls: %zu\n", prm_write_generations(prm, &arena, file));
+        if (fclose(file) != 0) {
+            fprintf(stderr, "ERROR: unable to write file %s\n", argv[2]);
+            exit(1);
+        }
+        arena_free(&arena);
+        return 0;
+    }
+
+    PaperRollMap *test = parse(&arena, "day04/test.txt");
+    assert(part1(test, &arena) == 13);
+    assert(part2(test, &arena) == 43);
+    assert(part1_scalar(test, &arena) == 13);
+    assert(part2_scalar(test, &arena) == 43);
+    assert(part2_sweep(test, &arena) == 43);
+    assert(part1_parallel(test, &arena) == 13);
+    assert(part2_parallel(test, &arena) == 43);
+    size_t counts[16] = {0};
+    assert(prm_remove_generations(test, &arena, generation_check, counts) == 43);
+    assert(counts[1] == 13 && counts[2] == 12 && counts[9] == 1 && counts[10] == 0);
+    arena_reset(&arena);
 
-    printf("Accessible rolls: %d\n", part1("day04/input.txt"));
-    printf("Removable rolls: %d\n", part2("day04/input.txt"));
+    PaperRollMap *input = parse(&arena, "day04/input.txt");
+    printf("Accessible rolls: %zu\n", part1(input, &arena));
+    printf("Removable rolls: %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
     return 0;
 }
+#endif // AOC_RUNNER
@@ -1,17 +1,19 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
-#define RANGES_CAPACITY 256
-#define ITEMS_CAPACITY 1024
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
 
 typedef struct {
     size_t beg;
     size_t end;
 } IdRange;
 
-int id_range_merge(IdRange *range, IdRange *other) {
+static int id_range_merge(IdRange *range, IdRange *other) {
     if (range->beg > other->end || range->end < other->beg){
         return 0;
     }
@@ -25,39 +27,39 @@ int id_range_merge(IdRange *range, IdRange *other) {
 }
 
 typedef struct {
-    IdRange ranges[RANGES_CAPACITY];
-    size_t  items[ITEMS_CAPACITY];
-    size_t  ranges_size;
-    size_t  items_size;
-} Inventory;
+    IdRange *items;
+    size_t size;
+    size_t capacity;
+} IdRangeArray;
 
-Inventory inventory_from_file(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
-        exit(1);
-    }
+typedef struct {
+    size_t *items;
+    size_t size;
+    size_t capacity;
+} ItemArray;
 
-    Inventory inventory = {
-        .ranges = {{0}},
-        .items = {0},
-        .ranges_size = 0,
-        .items_size = 0
-    };
+typedef struct {
+    IdRangeArray ranges;
+    ItemArray items;
+} Inventory;
 
-    size_t ranges_size = 0;
-    size_t items_size = 0;
+static Inventory *inventory_from_file(Arena *arena, char *file_path) {
+    Span input = input_map(file_path);
+
+    Inventory *inventory = arena_alloc(arena, sizeof(Inventory));
+    *inventory = (Inventory) {0};
 
     char c;
     size_t a = 0;
     size_t b = 0;
+    size_t i = 0;
 
-    while ((c = fgetc(fp)) != EOF) {
+    while (i < input.size) {
+        c = input.data[i++];
         if (c == '\n') {
             if (b == 0) break;
             assert(a <= b);
-            inventory.ranges[ranges_size] = (IdRange) { .beg = a, .end = b };
-            ranges_size++;
+            arena_da_append(arena, &inventory->ranges, ((IdRange) { .beg = a, .end = b }));
             a = 0;
             b = 0;
         } else if (c == '-') {
@@ -67,31 +69,30 @@ Inventory inventory_from_file(char *file_path) {
             b = b * 10 + c - 48;
         }
     }
-    inventory.ranges_size = ranges_size;
 
-    while ((c = fgetc(fp)) != EOF) {
+    while (i < input.size) {
+        c = input.data[i++];
         if (c == '\n') {
-            inventory.items[items_size] = b;
-            items_size++;
+            arena_da_append(arena, &inventory->items, b);
             b = 0;
         } else {
             b = b * 10 + c - 48;
         }
     }
-    inventory.items_size = items_size;
+    input_unmap(input);
     return inventory;
 }
 
-size_t inventory_count_items_in_ranges(Inventory *inventory) {
+static size_t inventory_count_items_in_ranges(Inventory *inventory) {
     size_t count = 0;
     size_t curr_item;
     size_t found;
     IdRange curr_range;
-    for (size_t i = 0; i < inventory->items_size; ++i) {
+    for (size_t i = 0; i < inventory->items.size; ++i) {
         found = 0;
-        curr_item = inventory->items[i];
-        for (size_t j = 0; j < inventory->ranges_size; ++j) {
-            curr_range = inventory->ranges[j];
+        curr_item = inventory->items.items[i];
+        for (size_t j = 0; j < inventory->ranges.size; ++j) {
+            curr_range = inventory->ranges.items[j];
             if (curr_item >= curr_range.beg && curr_item <= curr_range.end) {
                 count++;
                 found = 1;
@@ -103,71 +104,418 @@ size_t inventory_count_items_in_ranges(Inventory *inventory) {
     return count;
 }
 
-void inventory_merge_ranges(Inventory *inventory) {
-    IdRange curr_range;
+static int id_range_compare(const void *a, const void *b) {
+    const IdRange *x = a;
+    const IdRange *y = b;
+    return (x->beg > y->beg) - (x->beg < y->beg);
+}
 
-    size_t found;
-    IdRange new_ranges[RANGES_CAPACITY] = {{0}};
-    size_t new_ranges_size;
+// Sorted by their beginning, a range can only overlap the last merged one,
+// so a single sweep merges them in place.
+static void inventory_merge_ranges(Inventory *inventory) {
+    IdRangeArray *ranges = &inventory->ranges;
+    if (ranges->size == 0) return;
+    qsort(ranges->items, ranges->size, sizeof(IdRange), id_range_compare);
+
+    size_t merged_size = 1;
+    for (size_t i = 1; i < ranges->size; ++i) {
+        if (!id_range_merge(&ranges->items[merged_size - 1], &ranges->items[i])) {
+            ranges->items[merged_size++] = ranges->items[i];
+        }
+    }
+    ranges->size = merged_size;
+}
 
-    size_t merging = 1;
+// Copy of the inventory with its ranges merged into scratch, the items are
+// shared with the original.
+static Inventory inventory_merged(Inventory *inventory, Arena *scratch) {
+    Inventory merged = { .ranges = { .size = 0, .capacity = 0 }, .items = inventory->items };
+    arena_da_reserve(scratch, &merged.ranges, inventory->ranges.size);
+    memcpy(merged.ranges.items, inventory->ranges.items, inventory->ranges.size * sizeof(IdRange));
+    merged.ranges.size = inventory->ranges.size;
+    inventory_merge_ranges(&merged);
+    return merged;
+}
 
-    while (merging) {
-        merging = 0;
+// Merged ranges in Eytzinger order: the children of node k are 2k and 2k + 1
+// and node 0 is unused. A search walks down one cache line at a time with no
+// branch to mispredict, and prefetches the grandchildren of the current node,
+// which share a cache line.
+typedef struct {
+    IdRange *tree;
+    size_t size;
+} RangeIndex;
 
-        new_ranges[0] = inventory->ranges[0];
-        new_ranges_size = 1;
+static size_t range_index_fill(RangeIndex *index, IdRange *sorted, size_t i, size_t k) {
+    if (k <= index->size) {
+        i = range_index_fill(index, sorted, i, 2 * k);
+        index->tree[k] = sorted[i++];
+        i = range_index_fill(index, sorted, i, 2 * k + 1);
+    }
+    return i;
+}
 
-        for (size_t i = 1; i < inventory->ranges_size; ++i) {
-            found = 0;
+// The ranges must be merged, so that both their beginnings and their ends
+// are sorted.
+static RangeIndex range_index_from(IdRangeArray *ranges, Arena *scratch) {
+    RangeIndex index = { .tree = arena_alloc(scratch, (ranges->size + 1) * sizeof(IdRange)), .size = ranges->size };
+    range_index_fill(&index, ranges->items, 0, 1);
+    return index;
+}
 
-            curr_range = inventory->ranges[i];
-            for (size_t j = 0; j < new_ranges_size; ++j) {
-                if (!id_range_merge(&new_ranges[j], &curr_range)) {
-                    continue;
-                }
-                merging = 1;
-                found = 1;
-                break;
-            }
-            if (!found) {
-                new_ranges[new_ranges_size] = curr_range;
-                new_ranges_size++;
-            }
+// Finds the first range that ends at or after id, it holds id unless it
+// begins after it.
+static int range_index_contains(RangeIndex *index, size_t id) {
+    size_t k = 1;
+    while (k <= index->size) {
+        __builtin_prefetch(index->tree + 4 * k);
+        k = 2 * k + (index->tree[k].end < id);
+    }
+    k >>= __builtin_ffsll(~k);
+    return k != 0 && index->tree[k].beg <= id;
+}
+
+static size_t inventory_count_items_indexed(Inventory *inventory, Arena *scratch) {
+    Inventory merged = inventory_merged(inventory, scratch);
+    RangeIndex index = range_index_from(&merged.ranges, scratch);
+    size_t count = 0;
+    for (size_t i = 0; i < inventory->items.size; ++i) {
+        count += range_index_contains(&index, inventory->items.items[i]);
+    }
+    return count;
+}
+
+static int item_compare(const void *a, const void *b) {
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// For bulk lookups: the sorted items and the merged ranges are walked
+// together once.
+static size_t inventory_count_items_joined(Inventory *inventory, Arena *scratch) {
+    Inventory merged = inventory_merged(inventory, scratch);
+    size_t *items = arena_alloc(scratch, inventory->items.size * sizeof(size_t));
+    memcpy(items, inventory->items.items, inventory->items.size * sizeof(size_t));
+    qsort(items, inventory->items.size, sizeof(size_t), item_compare);
+
+    size_t count = 0;
+    size_t r = 0;
+    for (size_t i = 0; i < inventory->items.size; ++i) {
+        while (r < merged.ranges.size && merged.ranges.items[r].end < items[i]) r++;
+        if (r == merged.ranges.size) break;
+        count += merged.ranges.items[r].beg <= items[i];
+    }
+    return count;
+}
+
+static size_t inventory_count_valid_ids(Inventory *inventory) {
+    size_t count = 0;
+    for (size_t i = 0; i < inventory->ranges.size; ++i) {
+        count += inventory->ranges.items[i].end - inventory->ranges.items[i].beg + 1;
+    }
+    return count;
+}
+
+// Packed indexes hold the merged ranges in a form that is queried straight
+// from a mapped file, so loading one costs nothing. After the header comes
+// one IndexBlock per PACKED_BLOCK_RANGES ranges, then the ranges themselves
+// as LEB128 varints: the gap from the end of the previous range (from the
+// block's beginning for its first range), then the length minus one.
+#define INDEX_MAGIC "D05RNG02"
+#define PACKED_BLOCK_RANGES 64
+#define STREAM_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    char magic[8];
+    uint64_t size;
+    uint64_t valid_ids;
+    uint64_t blocks;
+} IndexHeader;
+
+typedef struct {
+    uint64_t beg;
+    uint64_t offset;
+} IndexBlock;
+
+typedef struct {
+    const IndexHeader *header;
+    const IndexBlock *blocks;
+    const uint8_t *ranges;
+    size_t ranges_size;
+} PackedIndex;
+
+static uint8_t *varint_put(uint8_t *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Returns 0 when the varint runs past end or past 64 bits.
+static int varint_get(const uint8_t **in, const uint8_t *end, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *in < end; shift += 7) {
+        uint8_t byte = *(*in)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) return 1;
+    }
+    return 0;
+}
+
+// Packs merged ranges into a buffer in the arena, ready to be saved.
+static Span packed_index_from(Inventory *merged, Arena *arena) {
+    IdRangeArray *ranges = &merged->ranges;
+    size_t blocks = (ranges->size + PACKED_BLOCK_RANGES - 1) / PACKED_BLOCK_RANGES;
+    // A varint takes at most 10 bytes, the unused tail is given back below.
+    size_t capacity = sizeof(IndexHeader) + blocks * sizeof(IndexBlock) + ranges->size * 20;
+    uint8_t *data = arena_alloc(arena, capacity);
+
+    IndexHeader *header = (IndexHeader *)data;
+    *header = (IndexHeader) { .size = ranges->size, .valid_ids = inventory_count_valid_ids(merged), .blocks = blocks };
+    memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+    IndexBlock *block = (IndexBlock *)(data + sizeof(IndexHeader));
+    uint8_t *start = (uint8_t *)(block + blocks);
+
+    uint8_t *out = start;
+    size_t previous = 0;
+    for (size_t i = 0; i < ranges->size; ++i) {
+        IdRange range = ranges->items[i];
+        if (i % PACKED_BLOCK_RANGES == 0) {
+            *block++ = (IndexBlock) { .beg = range.beg, .offset = (uint64_t)(out - start) };
+            previous = range.beg;
         }
-        for (size_t i = 0; i < new_ranges_size; ++i) {
-            inventory->ranges[i] = new_ranges[i];
-            new_ranges[i] = (IdRange) {0};
+        out = varint_put(out, range.beg - previous);
+        out = varint_put(out, range.end - range.beg);
+        previous = range.end;
+    }
+
+    size_t size = (size_t)(out - data);
+    data = arena_realloc(arena, data, capacity, size);
+    return (Span) { .data = (const char *)data, .size = size };
+}
+
+static void packed_index_save(Span packed, char *file_path) {
+    FILE *file = fopen(file_path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: unable to write file %s\n", file_path);
+        exit(1);
+    }
+    fwrite(packed.data, 1, packed.size, file);
+    if (ferror(file) || fclose(file) != 0) {
+        fprintf(stderr, "ERROR: unable to write file %s\n", file_path);
+        exit(1);
+    }
+}
+
+static void packed_index_invalid(char *name) {
+    fprintf(stderr, "ERROR: %s is not a range index\n", name);
+    exit(1);
+}
+
+// Checks the header and the size of the block table only, so loading stays
+// O(1). Block offsets are checked by the lookups that use them. The index
+// points into data.
+static PackedIndex packed_index_load(Span data, char *name) {
+    if (data.size < sizeof(IndexHeader)) packed_index_invalid(name);
+    const IndexHeader *header = (const IndexHeader *)data.data;
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0
+        || header->blocks != header->size / PACKED_BLOCK_RANGES + (header->size % PACKED_BLOCK_RANGES != 0)
+        || header->blocks > (data.size - sizeof(IndexHeader)) / sizeof(IndexBlock)) {
+        packed_index_invalid(name);
+    }
+    size_t ranges_offset = sizeof(IndexHeader) + header->blocks * sizeof(IndexBlock);
+    PackedIndex index = {
+        .header = header,
+        .blocks = (const IndexBlock *)(data.data + sizeof(IndexHeader)),
+        .ranges = (const uint8_t *)data.data + ranges_offset,
+        .ranges_size = data.size - ranges_offset,
+    };
+    return index;
+}
+
+// Finds the last block beginning at or before id, checks that its bytes lie
+// within the index, then decodes at most one block of ranges.
+static int packed_index_contains(PackedIndex *index, size_t id) {
+    size_t blocks = index->header->blocks;
+    if (blocks == 0 || index->blocks[0].beg > id) return 0;
+
+    size_t b = 0;
+    while (blocks > 1) {
+        size_t half = blocks / 2;
+        b = index->blocks[b + half].beg <= id ? b + half : b;
+        blocks -= half;
+    }
+
+    uint64_t offset = index->blocks[b].offset;
+    uint64_t next = b + 1 < index->header->blocks ? index->blocks[b + 1].offset : index->ranges_size;
+    if (offset >= next || next > index->ranges_size) {
+        fprintf(stderr, "ERROR: range index block %zu is out of bounds\n", b);
+        exit(1);
+    }
+    const uint8_t *in = index->ranges + offset;
+    const uint8_t *in_end = index->ranges + next;
+    size_t count = index->header->size - b * PACKED_BLOCK_RANGES;
+    if (count > PACKED_BLOCK_RANGES) count = PACKED_BLOCK_RANGES;
+    size_t previous = index->blocks[b].beg;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t gap, length;
+        if (!varint_get(&in, in_end, &gap) || !varint_get(&in, in_end, &length)) {
+            fprintf(stderr, "ERROR: range index block %zu is truncated\n", b);
+            exit(1);
         }
-        inventory->ranges_size = new_ranges_size;
+        size_t beg = previous + gap;
+        size_t end = beg + length;
+        if (id < beg) return 0;
+        if (id <= end) return 1;
+        previous = end;
     }
+    return 0;
 }
 
-size_t inventory_count_valid_ids(Inventory *inventory) {
+// Classifies one item ID per line as it is read, in fixed-size blocks, so
+// that feeds of any length run in constant memory.
+static size_t packed_index_count_stream(PackedIndex *index, FILE *file) {
+    static char buffer[STREAM_BUFFER_SIZE];
     size_t count = 0;
-    for (size_t i = 0; i < inventory->ranges_size; ++i) {
-        count += inventory->ranges[i].end - inventory->ranges[i].beg + 1;
+    size_t id = 0;
+    int digits = 0;
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (size_t i = 0; i < read; ++i) {
+            char c = buffer[i];
+            if (c >= '0' && c <= '9') {
+                id = id * 10 + (size_t)(c - '0');
+                digits = 1;
+            } else if (c == '\n' && digits) {
+                count += packed_index_contains(index, id);
+                id = 0;
+                digits = 0;
+            }
+        }
     }
+    if (digits) count += packed_index_contains(index, id);
     return count;
 }
 
-size_t part1(char *file_path) {
-    Inventory inventory = inventory_from_file(file_path);
-    return inventory_count_items_in_ranges(&inventory);
+static size_t part1(void *input, Arena *scratch) {
+    Inventory *inventory = input;
+    return inventory_count_items_indexed(inventory, scratch);
+}
+
+static size_t part2(void *input, Arena *scratch) {
+    Inventory *inventory = input;
+    Inventory merged = inventory_merged(inventory, scratch);
+    return inventory_count_valid_ids(&merged);
+}
+
+static size_t part1_linear(void *input, Arena *scratch) {
+    (void)scratch;
+    Inventory *inventory = input;
+    return inventory_count_items_in_ranges(inventory);
+}
+
+static size_t part1_join(void *input, Arena *scratch) {
+    Inventory *inventory = input;
+    return inventory_count_items_joined(inventory, scratch);
+}
+
+static size_t part1_packed(void *input, Arena *scratch) {
+    Inventory *inventory = input;
+    Inventory merged = inventory_merged(inventory, scratch);
+    PackedIndex index = packed_index_load(packed_index_from(&merged, scratch), "packed index");
+    size_t count = 0;
+    for (size_t i = 0; i < inventory->items.size; ++i) {
+        count += packed_index_contains(&index, inventory->items.items[i]);
+    }
+    return count;
 }
 
-size_t part2(char *file_path) {
-    Inventory inventory = inventory_from_file(file_path);
-    inventory_merge_ranges(&inventory);
-    return inventory_count_valid_ids(&inventory);
+static size_t part2_packed(void *input, Arena *scratch) {
+    Inventory *inventory = input;
+    Inventory merged = inventory_merged(inventory, scratch);
+    PackedIndex index = packed_index_load(packed_index_from(&merged, scratch), "packed index");
+    return index.header->valid_ids;
 }
 
-int main() {
-    assert(part1("day05/test.txt") == 3);
-    assert(part2("day05/test.txt") == 14);
+static const Variant variants[] = {
+    { .name = "linear", .part1 = part1_linear, .part2 = part2 },
+    { .name = "join", .part1 = part1_join, .part2 = part2 },
+    { .name = "packed", .part1 = part1_packed, .part2 = part2_packed },
+};
+
+static void *parse(Arena *arena, char *file_path) {
+    return inventory_from_file(arena, file_path);
+}
+
+const Day day05 = {
+    .name = "day05",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .variants = variants,
+    .variants_count = sizeof(variants) / sizeof(variants[0]),
+    .test1 = 3,
+    .test2 = 14
+};
+
+#ifndef AOC_RUNNER
+static void usage(char *program) {
+    fprintf(stderr, "Usage: %s [index INPUT INDEX | classify INDEX [ITEMS]]\n", program);
+    exit(2);
+}
+
+// "index" saves the merged ranges of INPUT, "classify" counts the fresh
+// item IDs of ITEMS, or of the standard input, against a saved index.
+int main(int argc, char **argv) {
+    Arena arena = {0};
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "index") == 0 && argc == 4) {
+            Inventory *inventory = parse(&arena, argv[2]);
+            Inventory merged = inventory_merged(inventory, &arena);
+            packed_index_save(packed_index_from(&merged, &arena), argv[3]);
+        } else if (strcmp(argv[1], "classify") == 0 && (argc == 3 || argc == 4)) {
+            Span mapping = input_map(argv[2]);
+            PackedIndex index = packed_index_load(mapping, argv[2]);
+            printf("Possible IDs: %zu\n", (size_t)index.header->valid_ids);
+            FILE *file = argc == 4 ? fopen(argv[3], "rb") : stdin;
+            if (file == NULL) {
+                fprintf(stderr, "ERROR: unable to read file %s\n", argv[3]);
+                exit(1);
+            }
+            printf("Fresh ingredients: %zu\n", packed_index_count_stream(&index, file));
+            if (file != stdin) fclose(file);
+            input_unmap(mapping);
+        } else {
+            usage(argv[0]);
+        }
+        arena_free(&arena);
+        return 0;
+    }
+
+    Inventory *test = parse(&arena, "day05/test.txt");
+    assert(part1(test, &arena) == 3);
+    assert(part2(test, &arena) == 14);
+    assert(part1_linear(test, &arena) == 3);
+    assert(part1_join(test, &arena) == 3);
+    assert(part1_packed(test, &arena) == 3);
+    assert(part2_packed(test, &arena) == 14);
+    Inventory merged = inventory_merged(test, &arena);
+    PackedIndex index = packed_index_load(packed_index_from(&merged, &arena), "test index");
+    char items[] = "1\n5\n8\n11\n17\n32";
+    FILE *feed = fmemopen(items, sizeof(items) - 1, "r");
+    assert(packed_index_count_stream(&index, feed) == 3);
+    fclose(feed);
+    arena_reset(&arena);
 
-    printf("Fresh ingredients: %zu\n", part1("day05/input.txt"));
-    printf("Possible IDs: %zu\n", part2("day05/input.txt"));
+    Inventory *input = parse(&arena, "day05/input.txt");
+    printf("Fresh ingredients: %zu\n", part1(input, &arena));
+    printf("Possible IDs: %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
     return 0;
 }
+#endif // AOC_RUNNER
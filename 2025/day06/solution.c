@@ -1,11 +1,19 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#define OPERANDS_CAPACITY 8
-#define PROBLEMS_CAPACITY 1024
-#define STR_BUFFER_CAPACITY 4096
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
+#include "../common/pool.h"
 
 typedef enum {
     NONE = 0,
@@ -13,7 +21,7 @@ typedef enum {
     MUL
 } Operator;
 
-Operator operator_from_char(char c) {
+static Operator operator_from_char(char c) {
     switch (c) {
         case '+':
             return ADD;
@@ -25,33 +33,48 @@ Operator operator_from_char(char c) {
     }
 }
 
+// Problems are stored as parallel arrays. The operands of problem i are
+// operands[offsets[i]] up to operands[offsets[i + 1]].
 typedef struct {
-    size_t operands[OPERANDS_CAPACITY];
-    size_t operands_count;
-    Operator operator;
-} Problem;
+    uint8_t *operators;
+    size_t *offsets;
+    size_t *operands;
+    size_t size;
+} ProblemsList;
 
-void problem_add_operand(Problem *problem, size_t operand) {
-    problem->operands[problem->operands_count++] = operand;
+// Answers are exact in 128 bits, an answer past that is an error.
+static uint128_t operands_product(const size_t *operands, size_t count) {
+    uint128_t answer = 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (__builtin_mul_overflow(answer, (uint128_t)operands[i], &answer)) {
+            fprintf(stderr, "ERROR: problem answer does not fit in 128 bits\n");
+            exit(1);
+        }
+    }
+    return answer;
 }
 
-void problem_set_operator(Problem *problem, Operator operator) {
-    problem->operator = operator;
+// Grand totals are exact in 128 bits too, a sum of answers past that is an
+// error rather than a wrapped total.
+static void grand_total_add(uint128_t *grand_total, uint128_t answer) {
+    if (__builtin_add_overflow(*grand_total, answer, grand_total)) {
+        fprintf(stderr, "ERROR: grand total does not fit in 128 bits\n");
+        exit(1);
+    }
 }
 
-size_t problem_calculate_answer(Problem *problem) {
-    size_t answer = 0;
-    switch (problem->operator) {
+static uint128_t problems_list_calculate_answer(ProblemsList *problems_list, size_t idx) {
+    size_t beg = problems_list->offsets[idx];
+    size_t end = problems_list->offsets[idx + 1];
+    uint128_t answer = 0;
+    switch (problems_list->operators[idx]) {
         case ADD:
-            for (size_t i = 0; i < problem->operands_count; ++i) {
-                answer += problem->operands[i];
+            for (size_t i = beg; i < end; ++i) {
+                answer += problems_list->operands[i];
             }
             break;
         case MUL:
-            answer = 1;
-            for (size_t i = 0; i < problem->operands_count; ++i) {
-                answer *= problem->operands[i];
-            }
+            answer = operands_product(problems_list->operands + beg, end - beg);
             break;
         default:
             fprintf(stderr, "ERROR: unreachable state\n");
@@ -60,158 +83,506 @@ size_t problem_calculate_answer(Problem *problem) {
     return answer;
 }
 
-void problem_print(Problem *problem) {
-    char op = problem->operator == ADD ? '+' : '*';
-    printf("%zu", problem->operands[0]);
-    for (size_t i = 1; i < problem->operands_count; ++i) {
-        printf(" %c %zu", op, problem->operands[i]);
+static void problems_list_print(ProblemsList *problems_list) {
+    for (size_t p = 0; p < problems_list->size; ++p) {
+        char op = problems_list->operators[p] == ADD ? '+' : '*';
+        for (size_t i = problems_list->offsets[p]; i < problems_list->offsets[p + 1]; ++i) {
+            if (i > problems_list->offsets[p]) printf(" %c ", op);
+            printf("%zu", problems_list->operands[i]);
+        }
+        printf("\n");
+    }
+}
+
+static size_t problems_list_calculate_grand_total(ProblemsList *problems_list) {
+    uint128_t grand_total = 0;
+    for (size_t i = 0; i < problems_list->size; ++i) {
+        grand_total_add(&grand_total, problems_list_calculate_answer(problems_list, i));
+    }
+    return answer_narrow(grand_total, "grand total");
+}
+
+// Every addition problem adds its operands straight to the grand total, so
+// all of them are one flat sum. Lanes keep 64-bit sums and count their
+// carries, which together make an exact 128-bit total.
+static uint128_t operands_sum(const size_t *operands, size_t count) {
+    uint128_t sum = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i sign = _mm256_set1_epi64x((long long)((uint64_t)1 << 63));
+    __m256i low = _mm256_setzero_si256();
+    __m256i carries = _mm256_setzero_si256();
+    for (; i + 4 <= count; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(operands + i));
+        __m256i t = _mm256_add_epi64(low, x);
+        __m256i wrapped = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), _mm256_xor_si256(t, sign));
+        carries = _mm256_sub_epi64(carries, wrapped);
+        low = t;
+    }
+    uint64_t lanes[4];
+    uint64_t lane_carries[4];
+    _mm256_storeu_si256((__m256i *)lanes, low);
+    _mm256_storeu_si256((__m256i *)lane_carries, carries);
+    for (size_t l = 0; l < 4; ++l) {
+        sum += lanes[l] + ((uint128_t)lane_carries[l] << 64);
+    }
+#endif
+    for (; i < count; ++i) {
+        sum += operands[i];
     }
-    printf("\n");
+    return sum;
 }
 
+// Problems split by operator: the operands of every addition in one flat
+// array, and the multiplications with their own offsets.
 typedef struct {
-    Problem problems[PROBLEMS_CAPACITY]; 
-    size_t problems_count;
-} ProblemsList;
+    size_t *adds;
+    size_t adds_size;
+    size_t *mul_offsets;
+    size_t *mul_operands;
+    size_t muls_size;
+} ProblemBatches;
+
+static ProblemBatches problem_batches_from(ProblemsList *problems_list, Arena *scratch) {
+    size_t operands = problems_list->offsets[problems_list->size];
+    ProblemBatches batches = {
+        .adds = arena_alloc(scratch, operands * sizeof(size_t)),
+        .mul_offsets = arena_alloc(scratch, (problems_list->size + 1) * sizeof(size_t)),
+        .mul_operands = arena_alloc(scratch, operands * sizeof(size_t)),
+    };
+    size_t mul_operands = 0;
+    batches.mul_offsets[0] = 0;
+    for (size_t p = 0; p < problems_list->size; ++p) {
+        size_t beg = problems_list->offsets[p];
+        size_t count = problems_list->offsets[p + 1] - beg;
+        if (problems_list->operators[p] == ADD) {
+            memcpy(batches.adds + batches.adds_size, problems_list->operands + beg, count * sizeof(size_t));
+            batches.adds_size += count;
+        } else {
+            memcpy(batches.mul_operands + mul_operands, problems_list->operands + beg, count * sizeof(size_t));
+            mul_operands += count;
+            batches.mul_offsets[++batches.muls_size] = mul_operands;
+        }
+    }
+    return batches;
+}
+
+#define BATCH_TASKS_PER_THREAD 4
 
-int char_is_numeric(char c) {
+static uint128_t adds_slice_sum(void *ctx, size_t beg, size_t end) {
+    ProblemBatches *batches = ctx;
+    return operands_sum(batches->adds + beg, end - beg);
+}
+
+static uint128_t muls_slice_sum(void *ctx, size_t beg, size_t end) {
+    ProblemBatches *batches = ctx;
+    uint128_t total = 0;
+    for (size_t p = beg; p < end; ++p) {
+        size_t offset = batches->mul_offsets[p];
+        grand_total_add(&total, operands_product(batches->mul_operands + offset, batches->mul_offsets[p + 1] - offset));
+    }
+    return total;
+}
+
+static size_t problems_list_calculate_grand_total_batched(ProblemsList *problems_list, Arena *scratch) {
+    ProblemBatches batches = problem_batches_from(problems_list, scratch);
+    uint128_t grand_total = pool_sum_slices(batches.adds_size, BATCH_TASKS_PER_THREAD, adds_slice_sum, &batches, scratch);
+    grand_total_add(&grand_total, pool_sum_slices(batches.muls_size, BATCH_TASKS_PER_THREAD, muls_slice_sum, &batches, scratch));
+    return answer_narrow(grand_total, "grand total");
+}
+
+static int char_is_numeric(char c) {
     return (c >= 48 && c <= 57);
 }
-int char_is_operator(char c) {
+static int char_is_operator(char c) {
     return (c == 42 || c == 43);
 }
 
-ProblemsList problems_list_from_file(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
-        exit(1);
+// Folds the next character down a column into its number. A number starts
+// at the first non-zero digit and ends at the first space below it, where
+// this returns 0. Columns whose number stays 0 hold no operand.
+static int column_operand_push(size_t *operand, char c) {
+    if (*operand != 0 && c == ' ') return 0;
+    if (char_is_numeric(c)) *operand = *operand * 10 + c - 48;
+    return 1;
+}
+
+// Rows may be shorter than the widest row, missing columns read as spaces.
+static char line_char_at(Span line, size_t j) {
+    return j < line.size ? line.data[j] : ' ';
+}
+
+typedef struct {
+    Span *items;
+    size_t size;
+    size_t capacity;
+} SpanArray;
+
+// Sets bit j of blank for every column j that is a space in every row, and
+// for the padding past width. Whole registers of every row are compared at
+// once.
+static void lines_blank_columns(SpanArray *lines, size_t width, uint64_t *blank) {
+    size_t words = (width + 63) / 64;
+    for (size_t w = 0; w < words; ++w) {
+        blank[w] = ~(uint64_t)0;
     }
 
-    ProblemsList problems_list = { 
-        .problems = { { .operands = {0}, .operands_count = 0, .operator = 0 } }, 
-        .problems_count = 0 
-    };
+    for (size_t i = 0; i < lines->size; ++i) {
+        Span line = lines->items[i];
+        size_t j = 0;
+#if defined(__AVX2__)
+        const __m256i space = _mm256_set1_epi8(' ');
+        for (; j + 64 <= line.size; j += 64) {
+            __m256i lo = _mm256_loadu_si256((const __m256i *)(line.data + j));
+            __m256i hi = _mm256_loadu_si256((const __m256i *)(line.data + j + 32));
+            uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, space));
+            mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, space)) << 32;
+            blank[j / 64] &= mask;
+        }
+#endif
+        for (; j < line.size; ++j) {
+            if (line.data[j] != ' ') blank[j / 64] &= ~((uint64_t)1 << (j % 64));
+        }
+    }
+}
 
-    char c;
-    size_t curr_operand = 0;
-    size_t problems_count = 0;
-    size_t operands_count = 0;
-    
-    while ((c = fgetc(fp)) != EOF) {
-        if (c == ' ') {
-            if (curr_operand == 0) {
-                continue;
-            }
-            problems_list.problems[problems_count].operands[operands_count] = curr_operand;
-            problems_count++;
-            curr_operand = 0;
-        } else if (c == '\n') {
-            if (curr_operand != 0) {
-                problems_list.problems[problems_count].operands[operands_count] = curr_operand;
-                problems_count++;
-            } 
-            assert(problems_list.problems_count == problems_count || problems_list.problems_count == 0);
-            problems_list.problems_count = problems_count;
-            curr_operand = 0;
-            problems_count = 0;
-            operands_count++;
-        } else if (char_is_numeric(c)) {
-            curr_operand = curr_operand * 10 + c - 48;
-        } else if (char_is_operator(c)) {
-            problems_list.problems[problems_count].operands_count = operands_count;
-            problems_list.problems[problems_count].operator = operator_from_char(c);
-            problems_count++;  
-        } else {
+static void problems_list_alloc(Arena *arena, ProblemsList *problems_list, size_t problems, size_t operands) {
+    problems_list->operators = arena_alloc(arena, problems * sizeof(uint8_t));
+    problems_list->offsets = arena_alloc(arena, (problems + 1) * sizeof(size_t));
+    problems_list->operands = arena_alloc(arena, operands * sizeof(size_t));
+    problems_list->offsets[0] = 0;
+    problems_list->size = 0;
+}
+
+// Both parts read the same worksheet, just in a different direction.
+typedef struct {
+    ProblemsList rows;
+    ProblemsList columns;
+} Worksheet;
+
+// Problems are the runs of columns that are not blank in every row, the last
+// row holds their operators. Each problem is read once, row by row for the
+// rows and digit column by digit column for the cephalopod math columns.
+static Worksheet *worksheet_from_span(Arena *arena, Span input) {
+    SpanArray lines = {0};
+    size_t width = 0;
+    Lines input_lines = lines_from_span(input);
+    Span line;
+    while (lines_next(&input_lines, &line)) {
+        if (line.size > width) width = line.size;
+        arena_da_append(arena, &lines, line);
+    }
+    assert(lines.size > 0);
+    size_t operand_rows = lines.size - 1;
+    Span operators = lines.items[operand_rows];
+
+    size_t words = (width + 63) / 64;
+    uint64_t *blank = arena_alloc(arena, (words + 1) * sizeof(uint64_t));
+    lines_blank_columns(&lines, width, blank);
+    blank[words] = ~(uint64_t)0;
+
+    // A problem starts at every used column that follows a blank one.
+    size_t problems = 0;
+    size_t used_columns = 0;
+    uint64_t previous_used = 0;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t used = ~blank[w];
+        if (w == words - 1 && width % 64 != 0) used &= ((uint64_t)1 << (width % 64)) - 1;
+        problems += __builtin_popcountll(used & ~((used << 1) | previous_used));
+        used_columns += __builtin_popcountll(used);
+        previous_used = used >> 63;
+    }
+
+    Worksheet *worksheet = arena_alloc(arena, sizeof(Worksheet));
+    problems_list_alloc(arena, &worksheet->rows, problems, problems * operand_rows);
+    problems_list_alloc(arena, &worksheet->columns, problems, used_columns);
+    ProblemsList *rows = &worksheet->rows;
+    ProblemsList *columns = &worksheet->columns;
+
+    size_t j = 0;
+    while (j < width) {
+        if ((blank[j / 64] >> (j % 64)) & 1) {
+            j++;
+            continue;
+        }
+        size_t beg = j;
+        while (!((blank[j / 64] >> (j % 64)) & 1)) j++;
+        size_t end = j;
+
+        Operator operator = NONE;
+        for (size_t k = beg; k < end; ++k) {
+            char c = line_char_at(operators, k);
+            if (char_is_operator(c)) operator = operator_from_char(c);
+        }
+        if (operator == NONE) {
             fprintf(stderr, "ERROR: unreachable state\n");
             exit(1);
         }
-    }
-    return problems_list;
-}
 
-void problems_list_print(ProblemsList *problems_list) {
-    for (size_t i = 0; i < problems_list->problems_count; ++i) {
-        problem_print(&problems_list->problems[i]);
+        size_t row_operands = rows->offsets[rows->size];
+        for (size_t i = 0; i < operand_rows; ++i) {
+            size_t operand = 0;
+            int digits = 0;
+            for (size_t k = beg; k < end; ++k) {
+                char c = line_char_at(lines.items[i], k);
+                if (!char_is_numeric(c)) continue;
+                operand = operand * 10 + c - 48;
+                digits = 1;
+            }
+            if (digits) rows->operands[row_operands++] = operand;
+        }
+        rows->operators[rows->size] = operator;
+        rows->offsets[++rows->size] = row_operands;
+
+        size_t column_operands = columns->offsets[columns->size];
+        for (size_t k = beg; k < end; ++k) {
+            size_t operand = 0;
+            for (size_t i = 0; i < operand_rows; ++i) {
+                if (!column_operand_push(&operand, line_char_at(lines.items[i], k))) break;
+            }
+            if (operand != 0) columns->operands[column_operands++] = operand;
+        }
+        columns->operators[columns->size] = operator;
+        columns->offsets[++columns->size] = column_operands;
     }
+    assert(rows->size == problems && columns->size == problems);
+    return worksheet;
 }
 
-ProblemsList problems_list_from_file_cephalopod_math(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
+#define STREAM_BLOCK_WIDTH 4096
+#define STREAM_SCAN_SIZE (64 * 1024)
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} RowExtent;
+
+typedef struct {
+    RowExtent *items;
+    size_t size;
+    size_t capacity;
+} RowExtentArray;
+
+// Finds where every row of the file starts, reading it once in fixed-size
+// blocks.
+static RowExtentArray row_extents_from_fd(Arena *arena, int fd, char *file_path) {
+    RowExtentArray rows = {0};
+    static char buffer[STREAM_SCAN_SIZE];
+    size_t offset = 0;
+    size_t row_beg = 0;
+    ssize_t read_size;
+    while ((read_size = pread(fd, buffer, sizeof(buffer), (off_t)offset)) > 0) {
+        for (const char *c = buffer; (c = memchr(c, '\n', buffer + read_size - c)) != NULL; ++c) {
+            size_t row_end = offset + (size_t)(c - buffer);
+            arena_da_append(arena, &rows, ((RowExtent) { .offset = row_beg, .size = row_end - row_beg }));
+            row_beg = row_end + 1;
+        }
+        offset += (size_t)read_size;
+    }
+    if (read_size < 0) {
         fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
         exit(1);
     }
+    if (row_beg < offset) {
+        arena_da_append(arena, &rows, ((RowExtent) { .offset = row_beg, .size = offset - row_beg }));
+    }
+    return rows;
+}
 
-    ProblemsList problems_list = { 
-        .problems = { { .operands = {0}, .operands_count = 0, .operator = 0 } }, 
-        .problems_count = 0 
-    };
+// Reads columns [col, col + width) of a row, past its end they are spaces.
+static void row_read_block(int fd, RowExtent row, size_t col, size_t width, char *out, char *file_path) {
+    size_t size = 0;
+    while (col + size < row.size && size < width) {
+        size_t want = row.size - col - size < width - size ? row.size - col - size : width - size;
+        ssize_t got = pread(fd, out + size, want, (off_t)(row.offset + col + size));
+        if (got <= 0) {
+            fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
+            exit(1);
+        }
+        size += (size_t)got;
+    }
+    memset(out + size, ' ', width - size);
+}
+
+// Called for every problem in order, with its answer and the grand total so
+// far.
+typedef void (*ProblemFn)(void *ctx, size_t idx, size_t answer, size_t grand_total);
 
-    char lines[OPERANDS_CAPACITY][STR_BUFFER_CAPACITY];
-    size_t lines_count = 0;
+typedef struct {
+    int open;
+    Operator operator;
+    uint128_t sum;
+    uint128_t product;
+    int product_overflow;
+} StreamProblem;
+
+static uint128_t stream_problem_answer(StreamProblem *problem) {
+    switch (problem->operator) {
+        case ADD:
+            return problem->sum;
+        case MUL:
+            if (problem->product_overflow) {
+                fprintf(stderr, "ERROR: problem answer does not fit in 128 bits\n");
+                exit(1);
+            }
+            return problem->product;
+        default:
+            fprintf(stderr, "ERROR: unreachable state\n");
+            exit(1);
+    }
+}
 
-    while (fgets(lines[lines_count], STR_BUFFER_CAPACITY, fp)) {
-        lines_count++;
+// Cephalopod math over a worksheet of any width. The rows are read in
+// lockstep, STREAM_BLOCK_WIDTH columns of each at a time from their own
+// offsets, and every problem is folded into a running sum and product as its
+// columns go by. Memory is one block per row, whatever the file size.
+static size_t worksheet_stream_columns_fd(Arena *arena, int fd, char *file_path, ProblemFn on_problem, void *ctx) {
+    RowExtentArray rows = row_extents_from_fd(arena, fd, file_path);
+    assert(rows.size > 0);
+    size_t operand_rows = rows.size - 1;
+    size_t width = 0;
+    for (size_t i = 0; i < rows.size; ++i) {
+        if (rows.items[i].size > width) width = rows.items[i].size;
     }
-    
-    char curr_operator;
-    size_t curr_operand;
-    Problem *curr_problem;
+    char *blocks = arena_alloc(arena, rows.size * STREAM_BLOCK_WIDTH);
 
-    size_t j = 0;
-    while ((curr_operator = lines[lines_count - 1][j]) != '\n') {
-        if (!char_is_operator(curr_operator)) {
-            j++;
-            continue;
+    StreamProblem problem = {0};
+    size_t problems = 0;
+    uint128_t grand_total = 0;
+    for (size_t col = 0; col <= width; col += STREAM_BLOCK_WIDTH) {
+        // One column past the widest row is blank and closes the last problem.
+        size_t block_width = width + 1 - col < STREAM_BLOCK_WIDTH ? width + 1 - col : STREAM_BLOCK_WIDTH;
+        for (size_t i = 0; i < rows.size; ++i) {
+            row_read_block(fd, rows.items[i], col, block_width, blocks + i * STREAM_BLOCK_WIDTH, file_path);
         }
-        curr_problem = &problems_list.problems[problems_list.problems_count++];
-        problem_set_operator(curr_problem, operator_from_char(curr_operator));
-
-        int parsing = 1;
-        while (parsing && (lines[lines_count - 1][j]) != '\n') {
-            curr_operand = 0;
-            parsing = 0;
-            for (size_t i = 0; i < lines_count - 1; ++i) {
-                if (curr_operand != 0 && lines[i][j] == ' ') break;
-                if (char_is_numeric(lines[i][j])) {
-                    curr_operand = curr_operand * 10 + lines[i][j] - 48;
-                    parsing = 1;
-                }
+        const char *operators = blocks + operand_rows * STREAM_BLOCK_WIDTH;
+
+        for (size_t k = 0; k < block_width; ++k) {
+            int blank = 1;
+            for (size_t i = 0; i < rows.size && blank; ++i) {
+                blank = blocks[i * STREAM_BLOCK_WIDTH + k] == ' ';
+            }
+            if (blank) {
+                if (!problem.open) continue;
+                uint128_t answer = stream_problem_answer(&problem);
+                grand_total_add(&grand_total, answer);
+                if (on_problem != NULL) on_problem(ctx, problems, answer_narrow(answer, "grand total"), answer_narrow(grand_total, "grand total"));
+                problems++;
+                problem = (StreamProblem) {0};
+                continue;
             }
-            if (curr_operand != 0) {
-                problem_add_operand(curr_problem, curr_operand);
+            if (!problem.open) problem = (StreamProblem) { .open = 1, .operator = NONE, .sum = 0, .product = 1 };
+            if (char_is_operator(operators[k])) problem.operator = operator_from_char(operators[k]);
+
+            size_t operand = 0;
+            for (size_t i = 0; i < operand_rows; ++i) {
+                if (!column_operand_push(&operand, blocks[i * STREAM_BLOCK_WIDTH + k])) break;
             }
-            j++;
+            if (operand == 0) continue;
+            problem.sum += operand;
+            problem.product_overflow |= __builtin_mul_overflow(problem.product, (uint128_t)operand, &problem.product);
         }
     }
-    return problems_list;
+    return answer_narrow(grand_total, "grand total");
 }
 
-size_t problems_list_calculate_grand_total(ProblemsList *problems_list) {
-    size_t grand_total = 0;
-    for (size_t i = 0; i < problems_list->problems_count; ++i) {
-        grand_total += problem_calculate_answer(&problems_list->problems[i]);
+static size_t worksheet_stream_columns(Arena *arena, char *file_path, ProblemFn on_problem, void *ctx) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
+        exit(1);
     }
+    size_t grand_total = worksheet_stream_columns_fd(arena, fd, file_path, on_problem, ctx);
+    close(fd);
     return grand_total;
 }
 
-size_t part1(char *file_path) {
-    ProblemsList problems_list = problems_list_from_file(file_path);
-    return problems_list_calculate_grand_total(&problems_list);
+static size_t part1(void *input, Arena *scratch) {
+    (void)scratch;
+    Worksheet *worksheet = input;
+    return problems_list_calculate_grand_total(&worksheet->rows);
+}
+
+static size_t part2(void *input, Arena *scratch) {
+    (void)scratch;
+    Worksheet *worksheet = input;
+    return problems_list_calculate_grand_total(&worksheet->columns);
+}
+
+static size_t part1_batched(void *input, Arena *scratch) {
+    Worksheet *worksheet = input;
+    return problems_list_calculate_grand_total_batched(&worksheet->rows, scratch);
+}
+
+static size_t part2_batched(void *input, Arena *scratch) {
+    Worksheet *worksheet = input;
+    return problems_list_calculate_grand_total_batched(&worksheet->columns, scratch);
 }
 
-size_t part2(char *file_path) {
-    ProblemsList problems_list = problems_list_from_file_cephalopod_math(file_path);
-    return problems_list_calculate_grand_total(&problems_list);
+static const Variant variants[] = {
+    { .name = "batched", .part1 = part1_batched, .part2 = part2_batched },
+};
+
+static void *parse(Arena *arena, char *file_path) {
+    Span input = input_map(file_path);
+    Worksheet *worksheet = worksheet_from_span(arena, input);
+    input_unmap(input);
+    return worksheet;
 }
 
-int main() {
-    assert(part1("day06/test.txt") == 4277556);
-    assert(part2("day06/test.txt") == 3263827);
+const Day day06 = {
+    .name = "day06",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .variants = variants,
+    .variants_count = sizeof(variants) / sizeof(variants[0]),
+    .test1 = 4277556,
+    .test2 = 3263827
+};
+
+#ifndef AOC_RUNNER
+static void problem_print_answer(void *ctx, size_t idx, size_t answer, size_t grand_total) {
+    (void)ctx;
+    printf("%zu %zu %zu\n", idx, answer, grand_total);
+}
+
+// With a file argument its cephalopod math is streamed, printing every
+// problem's index, answer and the grand total so far.
+int main(int argc, char **argv) {
+    Arena arena = {0};
+
+    if (argc > 1) {
+        size_t grand_total = worksheet_stream_columns(&arena, argv[1], problem_print_answer, NULL);
+        printf("Grand total (cephalopod math): %zu\n", grand_total);
+        arena_free(&arena);
+        return 0;
+    }
+
+    Worksheet *test = parse(&arena, "day06/test.txt");
+    assert(part1(test, &arena) == 4277556);
+    assert(part2(test, &arena) == 3263827);
+    assert(part1_batched(test, &arena) == 4277556);
+    assert(part2_batched(test, &arena) == 3263827);
+    assert(worksheet_stream_columns(&arena, "day06/test.txt", NULL, NULL) == 3263827);
+
+    // Zero digits only continue a column's number, they never start one.
+    char zeros[] = "10\n5 \n* \n";
+    Worksheet *zeros_worksheet = worksheet_from_span(&arena, (Span) { .data = zeros, .size = sizeof(zeros) - 1 });
+    assert(part1(zeros_worksheet, &arena) == 50);
+    assert(part2(zeros_worksheet, &arena) == 15);
+    FILE *zeros_file = tmpfile();
+    fwrite(zeros, 1, sizeof(zeros) - 1, zeros_file);
+    fflush(zeros_file);
+    assert(worksheet_stream_columns_fd(&arena, fileno(zeros_file), "zeros", NULL, NULL) == 15);
+    fclose(zeros_file);
+    arena_reset(&arena);
 
-    printf("Grand total: %zu\n", part1("day06/input.txt"));
-    printf("Grand total (cephalopod math): %zu\n", part2("day06/input.txt"));
+    Worksheet *input = parse(&arena, "day06/input.txt");
+    printf("Grand total: %zu\n", part1(input, &arena));
+    printf("Grand total (cephalopod math): %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
     return 0;
 }
+#endif // AOC_RUNNER
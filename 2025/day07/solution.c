@@ -1,9 +1,13 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
-#define MAX_HEIGHT 256
+#include "../common/arena.h"
+#include "../common/day.h"
+#include "../common/input.h"
+
 #define MAX_WIDTH  256
 #define BYTES_COUNT 32
 #define BITS_COUNT 8 * BYTES_COUNT
@@ -12,7 +16,7 @@ typedef struct {
     uint8_t bytes[BYTES_COUNT];
 } Positions;
 
-void positions_print(Positions *positions) {
+static void positions_print(Positions *positions) {
     for (size_t i = 0; i < BYTES_COUNT; ++i) {
         for (size_t j = 0; j < 8; ++j) {
             putchar('0' + ((positions->bytes[BYTES_COUNT - i - 1] >> (7 - j)) & 1));
@@ -21,31 +25,31 @@ void positions_print(Positions *positions) {
     printf("\n");
 }
 
-void positions_bitwise_and(Positions *positions, Positions *other) {
+static void positions_bitwise_and(Positions *positions, Positions *other) {
     for (size_t i = 0; i < BYTES_COUNT; ++i) {
         positions->bytes[i] &= other->bytes[i];
     }
 }
 
-void positions_bitwise_or(Positions *positions, Positions *other) {
+static void positions_bitwise_or(Positions *positions, Positions *other) {
     for (size_t i = 0; i < BYTES_COUNT; ++i) {
         positions->bytes[i] |= other->bytes[i];
     }
 }
 
-void positions_bitwise_xor(Positions *positions, Positions *other) {
+static void positions_bitwise_xor(Positions *positions, Positions *other) {
     for (size_t i = 0; i < BYTES_COUNT; ++i) {
         positions->bytes[i] ^= other->bytes[i];
     }
 }
 
-void positions_flip_bit(Positions *positions, size_t idx) {
+static void positions_flip_bit(Positions *positions, size_t idx) {
     size_t byte_idx = idx / 8;
     size_t bit_idx = idx % 8;
     positions->bytes[byte_idx] ^= (1 << bit_idx);
 }
 
-void positions_lsh(Positions *positions, size_t count) {
+static void positions_lsh(Positions *positions, size_t count) {
     for (size_t c = 0; c < count; ++c) {
         uint8_t prev_overflow = 0;
         uint8_t curr_overflow = 0;
@@ -60,7 +64,7 @@ void positions_lsh(Positions *positions, size_t count) {
     }
 }
 
-void positions_rsh(Positions *positions, size_t count) {
+static void positions_rsh(Positions *positions, size_t count) {
     for (size_t c = 0; c < count; ++c) {
         uint8_t prev_underflow = 0;
         uint8_t curr_underflow = 0;
@@ -75,7 +79,7 @@ void positions_rsh(Positions *positions, size_t count) {
     }
 }
 
-size_t positions_count_ones(Positions *positions) {
+static size_t positions_count_ones(Positions *positions) {
     size_t count = 0;
     uint8_t curr_byte;
     for (size_t i = 0; i < BYTES_COUNT; ++i) {
@@ -88,56 +92,60 @@ size_t positions_count_ones(Positions *positions) {
     return count;
 }
 
+typedef struct {
+    Positions *items;
+    size_t size;
+    size_t capacity;
+} PositionsArray;
+
 typedef struct {
     Positions beams;
-    Positions rows[MAX_HEIGHT];
-    size_t rows_count;
+    PositionsArray rows;
 } Manifold;
 
-Manifold manifold_from_file(char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "ERROR: unable to read file %s\n", file_path);
-        exit(1);
-    }
+static Manifold *manifold_from_file(Arena *arena, char *file_path) {
+    Span input = input_map(file_path);
 
-    Manifold manifold = { 
+    Manifold *manifold = arena_alloc(arena, sizeof(Manifold));
+    *manifold = (Manifold) { 
         .beams = {0}, 
-        .rows = {{0}}, 
-        .rows_count = 0
+        .rows = {0}
     };
 
-    size_t i = 0;
-    char line_buffer[MAX_WIDTH];
+    Lines lines = lines_from_span(input);
+    Span line;
     size_t line_contains_splitter;
 
-    while (fgets(line_buffer, MAX_WIDTH, fp)) {
-        i = 0;
+    while (lines_next(&lines, &line)) {
+        assert(line.size <= MAX_WIDTH);
+        Positions row = {0};
         line_contains_splitter = 0;
-        while (line_buffer[i] != '\n') {
-            if (line_buffer[i] == 'S') {
-                positions_flip_bit(&manifold.beams, i);
+        for (size_t i = 0; i < line.size; ++i) {
+            if (line.data[i] == 'S') {
+                positions_flip_bit(&manifold->beams, i);
                 break;
             }
-            if (line_buffer[i] == '^') {
+            if (line.data[i] == '^') {
                 line_contains_splitter = 1;
-                positions_flip_bit(&manifold.rows[manifold.rows_count], i);
+                positions_flip_bit(&row, i);
             }
-            i++;
         }
-        if (line_contains_splitter) manifold.rows_count++;
+        if (line_contains_splitter) {
+            arena_da_append(arena, &manifold->rows, row);
+        }
     }
+    input_unmap(input);
     return manifold;
 }
 
-size_t manifold_count_splits(Manifold *manifold) {
+static size_t manifold_count_splits(Manifold *manifold) {
     size_t count = 0;
     Positions beams = manifold->beams; // copy starting beams
-    for (size_t i = 0; i < manifold->rows_count; ++i) {
+    for (size_t i = 0; i < manifold->rows.size; ++i) {
         Positions temp  = {0};
         Positions unsplit  = {0};
         positions_bitwise_xor(&unsplit, &beams); // copy beams to unsplit
-        positions_bitwise_and(&beams, &manifold->rows[i]); // beam intersects splitters
+        positions_bitwise_and(&beams, &manifold->rows.items[i]); // beam intersects splitters
         positions_bitwise_xor(&unsplit, &beams); // remove intersections from unsplit
         count += positions_count_ones(&beams); // add intersections aka splits to count
         positions_bitwise_xor(&temp, &beams); // copy beams to temp
@@ -149,9 +157,10 @@ size_t manifold_count_splits(Manifold *manifold) {
     return count;
 }
 
-size_t mct_recursive(Manifold *manifold, size_t idx, size_t row, size_t memo[][BITS_COUNT]) {
-    if (row == manifold->rows_count) return 1;
-    if (memo[idx][row] != 0) return memo[idx][row];
+static size_t mct_recursive(Manifold *manifold, size_t idx, size_t row, size_t *memo) {
+    if (row == manifold->rows.size) return 1;
+    size_t *memo_entry = &memo[idx * manifold->rows.size + row];
+    if (*memo_entry != 0) return *memo_entry;
 
     size_t count = 0;
 
@@ -161,7 +170,7 @@ size_t mct_recursive(Manifold *manifold, size_t idx, size_t row, size_t memo[][B
     positions_flip_bit(&left, idx);
     
     positions_bitwise_xor(&unsplit, &left); 
-    positions_bitwise_and(&left, &manifold->rows[row]); 
+    positions_bitwise_and(&left, &manifold->rows.items[row]); 
     positions_bitwise_xor(&unsplit, &left); 
     positions_bitwise_xor(&right, &left); 
     positions_lsh(&left, 1); 
@@ -179,39 +188,64 @@ size_t mct_recursive(Manifold *manifold, size_t idx, size_t row, size_t memo[][B
             count += overlapping * mct_recursive(manifold, next_idx, row + 1, memo);
         }
     }
-    memo[idx][row] = count;
+    *memo_entry = count;
     return count;
 }
 
-size_t manifold_count_timelines(Manifold *manifold) {
+static size_t manifold_count_timelines(Manifold *manifold, Arena *scratch) {
     size_t start_idx = 0;
 
-    size_t memo[BITS_COUNT][BITS_COUNT] = {{0}};
+    size_t memo_size = BITS_COUNT * manifold->rows.size * sizeof(size_t);
+    size_t *memo = arena_alloc(scratch, memo_size);
+    memset(memo, 0, memo_size);
+    Positions beams = manifold->beams; // copy, the manifold is shared by both parts
 
     while (start_idx < BYTES_COUNT * 8) {
-        if (manifold->beams.bytes[0] & 1) break;
-        positions_rsh(&manifold->beams, 1);
+        if (beams.bytes[0] & 1) break;
+        positions_rsh(&beams, 1);
         start_idx++;
     }
     return mct_recursive(manifold, start_idx, 0, memo);
 }
 
-size_t part1(char *file_path) {
-    Manifold manifold = manifold_from_file(file_path);
-    return manifold_count_splits(&manifold);
+static size_t part1(void *input, Arena *scratch) {
+    (void)scratch;
+    Manifold *manifold = input;
+    return manifold_count_splits(manifold);
 }
 
-size_t part2(char *file_path) {
-    Manifold manifold = manifold_from_file(file_path);
-    return manifold_count_timelines(&manifold);
+static size_t part2(void *input, Arena *scratch) {
+    Manifold *manifold = input;
+    return manifold_count_timelines(manifold, scratch);
 }
 
+static void *parse(Arena *arena, char *file_path) {
+    return manifold_from_file(arena, file_path);
+}
+
+const Day day07 = {
+    .name = "day07",
+    .parse = parse,
+    .part1 = part1,
+    .part2 = part2,
+    .test1 = 21,
+    .test2 = 40
+};
+
+#ifndef AOC_RUNNER
 int main() {
-    assert(part1("day07/test.txt") == 21);
-    assert(part2("day07/test.txt") == 40);
+    Arena arena = {0};
+
+    Manifold *test = parse(&arena, "day07/test.txt");
+    assert(part1(test, &arena) == 21);
+    assert(part2(test, &arena) == 40);
+    arena_reset(&arena);
 
-    printf("Total splits: %zu\n", part1("day07/input.txt"));
-    printf("Total timelines: %zu\n", part2("day07/input.txt"));
+    Manifold *input = parse(&arena, "day07/input.txt");
+    printf("Total splits: %zu\n", part1(input, &arena));
+    printf("Total timelines: %zu\n", part2(input, &arena));
+    arena_free(&arena);
 
     return 0;
 }
+#endif // AOC_RUNNER
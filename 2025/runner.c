@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "common/day.h"
+#include "common/pool.h"
+
+#define DAYS_COUNT 7
+#define PATH_CAPACITY 256
+
+extern const Day day01, day02, day03, day04, day05, day06, day07;
+
+static const Day *days[DAYS_COUNT] = {
+    &day01, &day02, &day03, &day04, &day05, &day06, &day07
+};
+
+typedef struct {
+    int test;
+    size_t reps;
+    size_t warmup;
+    char *file_path;
+    char *variant;
+} Options;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    uint64_t median;
+    uint64_t p99;
+} Timing;
+
+static Timing timing_from_samples(uint64_t *samples, size_t count) {
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    size_t p99_index = (count * 99 + 99) / 100 - 1;
+    return (Timing) { .median = samples[count / 2], .p99 = samples[p99_index] };
+}
+
+static void print_duration(uint64_t ns) {
+    if (ns < 10000) {
+        printf("%10lu ns", (unsigned long)ns);
+    } else if (ns < 10000000) {
+        printf("%10.3f us", ns / 1e3);
+    } else {
+        printf("%10.3f ms", ns / 1e6);
+    }
+}
+
+static void print_row(const char *name, const char *stage, char *answer, Timing timing) {
+    printf("%-6s %-16s %-20s ", name, stage, answer);
+    print_duration(timing.median);
+    printf("  ");
+    print_duration(timing.p99);
+    printf("\n");
+}
+
+static Timing time_parse(ParseFn parse, Arena *arena, char *file_path, Options *opts, uint64_t *samples) {
+    for (size_t i = 0; i < opts->warmup; ++i) {
+        parse(arena, file_path);
+        arena_reset(arena);
+    }
+    for (size_t i = 0; i < opts->reps; ++i) {
+        uint64_t start = now_ns();
+        parse(arena, file_path);
+        samples[i] = now_ns() - start;
+        arena_reset(arena);
+    }
+    return timing_from_samples(samples, opts->reps);
+}
+
+static Timing time_part(PartFn part, void *input, Arena *scratch, Options *opts, uint64_t *samples, size_t *answer) {
+    for (size_t i = 0; i < opts->warmup; ++i) {
+        *answer = part(input, scratch);
+        arena_reset(scratch);
+    }
+    for (size_t i = 0; i < opts->reps; ++i) {
+        uint64_t start = now_ns();
+        *answer = part(input, scratch);
+        samples[i] = now_ns() - start;
+        arena_reset(scratch);
+    }
+    return timing_from_samples(samples, opts->reps);
+}
+
+// Tests run every variant, otherwise only the one asked for with -v.
+static int variant_selected(Options *opts, const Variant *variant) {
+    if (opts->variant == NULL) return opts->test;
+    return strcmp(opts->variant, "all") == 0 || strcmp(opts->variant, variant->name) == 0;
+}
+
+// Runs one day in the calling process. Returns the number of failed checks.
+static int run_day(const Day *day, int parts, Options *opts) {
+    char file_path[PATH_CAPACITY];
+    if (opts->file_path != NULL) {
+        snprintf(file_path, PATH_CAPACITY, "%s", opts->file_path);
+    } else {
+        snprintf(file_path, PATH_CAPACITY, "%s/%s", day->name, opts->test ? "test.txt" : "input.txt");
+    }
+
+    uint64_t *samples = malloc(opts->reps * sizeof(uint64_t));
+    if (samples == NULL) {
+        fprintf(stderr, "ERROR: unable to allocate %zu samples\n", opts->reps);
+        exit(1);
+    }
+
+    Arena arena = {0};
+    Arena scratch = {0};
+
+    int failed = 0;
+    Timing timing = time_parse(day->parse, &arena, file_path, opts, samples);
+    print_row(day->name, "parse", "", timing);
+
+    void *input = day->parse(&arena, file_path);
+
+    size_t expected[2] = { day->test1, day->test2 };
+    for (int p = 0; p < 2; ++p) {
+        if (!(parts & (1 << p))) continue;
+
+        // The default part always runs first, its answer is the reference
+        // for the variants unless the expected test answer is known.
+        int check = opts->test && opts->file_path == NULL;
+        for (size_t v = 0; v <= day->variants_count; ++v) {
+            const Variant *variant = v > 0 ? &day->variants[v - 1] : NULL;
+            if (variant != NULL && !variant_selected(opts, variant)) continue;
+
+            PartFn part = variant == NULL ? day->part1 : variant->part1;
+            if (p == 1) part = variant == NULL ? day->part2 : variant->part2;
+
+            size_t answer = 0;
+            timing = time_part(part, input, &scratch, opts, samples, &answer);
+            if (variant == NULL && !check) {
+                expected[p] = answer;
+                check = 1;
+            }
+
+            char stage[32];
+            char answer_str[48];
+            if (variant == NULL) {
+                snprintf(stage, sizeof(stage), "part%d", p + 1);
+            } else {
+                snprintf(stage, sizeof(stage), "part%d/%s", p + 1, variant->name);
+            }
+            snprintf(answer_str, sizeof(answer_str), "%zu", answer);
+            if (check && answer != expected[p]) {
+                snprintf(answer_str, sizeof(answer_str), "%zu!=%zu", answer, expected[p]);
+                failed++;
+            }
+            print_row(day->name, stage, answer_str, timing);
+        }
+    }
+    arena_free(&scratch);
+    arena_free(&arena);
+    free(samples);
+    return failed;
+}
+
+// Runs one day in a child process so that its peak RSS is measured in
+// isolation from the other days.
+static int run_day_isolated(const Day *day, int parts, Options *opts) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "ERROR: unable to fork\n");
+        exit(1);
+    }
+    if (pid == 0) {
+        int failed = run_day(day, parts, opts);
+        fflush(stdout);
+        _exit(failed ? 1 : 0);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        fprintf(stderr, "ERROR: unable to wait for %s\n", day->name);
+        exit(1);
+    }
+    printf("%-6s %-16s %ld KiB\n", day->name, "rss", usage.ru_maxrss);
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+// Parses "3", "03", "day03" or "day03.2" into a day index and a part mask.
+static int parse_selector(char *arg, size_t *day_idx, int *parts) {
+    if (strncmp(arg, "day", 3) == 0) arg += 3;
+
+    char *end;
+    unsigned long n = strtoul(arg, &end, 10);
+    if (end == arg || n < 1 || n > DAYS_COUNT) return 0;
+    *day_idx = n - 1;
+    *parts = 3;
+
+    if (*end == '.') {
+        char *part_end;
+        unsigned long p = strtoul(end + 1, &part_end, 10);
+        if (part_end == end + 1 || *part_end != '\0' || p < 1 || p > 2) return 0;
+        *parts = 1 << (p - 1);
+    } else if (*end != '\0') {
+        return 0;
+    }
+    return 1;
+}
+
+static void usage(char *program) {
+    fprintf(stderr, "Usage: %s [-t] [-n reps] [-w warmup] [-j threads] [-v variant] [-f file] [day[.part] ...]\n", program);
+    fprintf(stderr, "  -t         run on dayNN/test.txt and check the expected answers\n");
+    fprintf(stderr, "  -n reps    timed repetitions per stage (default 1)\n");
+    fprintf(stderr, "  -w warmup  untimed repetitions before timing (default 0)\n");
+    fprintf(stderr, "  -j threads worker threads for parallel variants (default one per CPU)\n");
+    fprintf(stderr, "  -v variant also run this variant of each part, or every one with \"all\"\n");
+    fprintf(stderr, "  -f file    input file, instead of dayNN/input.txt\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    Options opts = { .test = 0, .reps = 1, .warmup = 0, .file_path = NULL, .variant = NULL };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "tn:w:j:v:f:")) != -1) {
+        switch (opt) {
+            case 't':
+                opts.test = 1;
+                break;
+            case 'n':
+                opts.reps = strtoul(optarg, NULL, 10);
+                if (opts.reps == 0) usage(argv[0]);
+                break;
+            case 'w':
+                opts.warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 'j':
+                pool_set_threads(strtoul(optarg, NULL, 10));
+                break;
+            case 'v':
+                opts.variant = optarg;
+                break;
+            case 'f':
+                opts.file_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    int selected[DAYS_COUNT] = {0};
+    if (optind == argc) {
+        for (size_t i = 0; i < DAYS_COUNT; ++i) selected[i] = 3;
+    }
+    for (int i = optind; i < argc; ++i) {
+        size_t day_idx;
+        int parts;
+        if (!parse_selector(argv[i], &day_idx, &parts)) usage(argv[0]);
+        selected[day_idx] |= parts;
+    }
+
+    printf("%-6s %-16s %-20s %13s  %13s\n", "day", "stage", "answer", "median", "p99");
+    int failed = 0;
+    for (size_t i = 0; i < DAYS_COUNT; ++i) {
+        if (selected[i] == 0) continue;
+        failed += run_day_isolated(days[i], selected[i], &opts);
+    }
+    if (failed) {
+        fprintf(stderr, "ERROR: %d day(s) failed\n", failed);
+        return 1;
+    }
+    return 0;
+}